@@ -10,9 +10,11 @@ include_directories(${ESPEAK_INC_DIR})
 link_directories(${ESPEAK_LIB_DIR})
 
 # onnxruntime
-set(ORT_INC_DIR ${THIRDPARTY_DIR}/onnxruntime-linux-aarch64-static_lib-1.16.0/include)
-set(ORT_LIB_DIR ${THIRDPARTY_DIR}/onnxruntime-linux-aarch64-static_lib-1.16.0/lib)
-list(APPEND ORT_LIBS onnxruntime)
+if (WITH_ONNXRUNTIME)
+    set(ORT_INC_DIR ${THIRDPARTY_DIR}/onnxruntime-linux-aarch64-static_lib-1.16.0/include)
+    set(ORT_LIB_DIR ${THIRDPARTY_DIR}/onnxruntime-linux-aarch64-static_lib-1.16.0/lib)
+    list(APPEND ORT_LIBS onnxruntime)
 
-include_directories(${ORT_INC_DIR})
-link_directories(${ORT_LIB_DIR})
\ No newline at end of file
+    include_directories(${ORT_INC_DIR})
+    link_directories(${ORT_LIB_DIR})
+endif()
\ No newline at end of file
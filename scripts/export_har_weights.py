@@ -0,0 +1,70 @@
+# Export the weights of SourceModuleHnNSF.l_linear from model4_har_sim.onnx
+# to har_weights.bin, which is used by the native HAR implementation (src/tts/kokoro_har.cpp).
+#
+# Layout: float32 [harmonic_num + 1] weights followed by 1 bias.
+#
+# Usage: python export_har_weights.py models-ax650/kokoro/model4_har_sim.onnx [har_weights.bin]
+
+import os
+import sys
+
+import numpy as np
+import onnx
+from onnx import numpy_helper
+
+
+def find_linear_before_tanh(model):
+    graph = model.graph
+    inits = {init.name: numpy_helper.to_array(init) for init in graph.initializer}
+    for node in graph.node:
+        if node.op_type == "Constant":
+            inits[node.output[0]] = numpy_helper.to_array(node.attribute[0].t)
+    producers = {out: node for node in graph.node for out in node.output}
+
+    for node in graph.node:
+        if node.op_type != "Tanh":
+            continue
+
+        linear = producers.get(node.input[0])
+        if linear is None:
+            continue
+
+        # Gemm(x, W, B)
+        if linear.op_type == "Gemm":
+            weight = inits[linear.input[1]]
+            bias = inits[linear.input[2]] if len(linear.input) > 2 else np.zeros(1, np.float32)
+            return weight, bias
+
+        # Add(MatMul(x, W), B)
+        if linear.op_type == "Add":
+            for i, name in enumerate(linear.input):
+                matmul = producers.get(name)
+                bias_name = linear.input[1 - i]
+                if matmul is not None and matmul.op_type == "MatMul" and bias_name in inits:
+                    weight = next(inits[n] for n in matmul.input if n in inits)
+                    return weight, inits[bias_name]
+
+    raise RuntimeError("Can not find the Linear + Tanh of SourceModuleHnNSF")
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: python export_har_weights.py <model4_har_sim.onnx> [har_weights.bin]")
+        sys.exit(1)
+
+    onnx_path = sys.argv[1]
+    output_path = sys.argv[2] if len(sys.argv) > 2 else os.path.join(os.path.dirname(onnx_path), "har_weights.bin")
+
+    weight, bias = find_linear_before_tanh(onnx.load(onnx_path))
+    weight = weight.astype(np.float32).reshape(-1)
+    bias = bias.astype(np.float32).reshape(-1)
+    assert bias.size == 1, f"Expect 1 output channel, got bias of shape {bias.shape}"
+
+    np.concatenate([weight, bias]).tofile(output_path)
+    print(f"weight: {weight}")
+    print(f"bias: {bias}")
+    print(f"Saved to {output_path}")
+
+
+if __name__ == "__main__":
+    main()
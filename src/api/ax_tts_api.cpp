@@ -7,11 +7,55 @@
  * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
  *
  **************************************************************************************************/
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
 #include "api/ax_tts_api.h"
 #include "tts/tts_factory.hpp"
+#include "tts/tts_request_queue.hpp"
 #include "utils/logger.h"
 #include "utils/AudioFile.h"
 
+// AX_TTS_HANDLE 指向的对象
+struct AxTtsHandle {
+    std::unique_ptr<TTSInterface> tts;
+    int num_workers;
+    // 只有用到 AX_TTS_Submit 时才创建工作线程
+    std::once_flag queue_once;
+    std::unique_ptr<TTSRequestQueue> queue;
+};
+
+static TTSInterface* get_tts(AX_TTS_HANDLE handle) {
+    return static_cast<AxTtsHandle*>(handle)->tts.get();
+}
+
+static TTSRequestQueue* get_queue(AX_TTS_HANDLE handle) {
+    auto h = static_cast<AxTtsHandle*>(handle);
+    std::call_once(h->queue_once, [h]() {
+        h->queue = std::make_unique<TTSRequestQueue>(h->tts.get(), h->num_workers);
+    });
+    return h->queue.get();
+}
+
+// 已发布的二进制按这个偏移读取音频, AX_TTS_AUDIO 不能在 data 之前加字段
+static_assert(offsetof(AX_TTS_AUDIO, data) == 3 * sizeof(int), "AX_TTS_AUDIO.data moved, ABI break");
+
+// 各个入口共用的 run_config 检查
+static bool check_run_config(const AX_TTS_RUN_CONFIG* run_config) {
+    if (!run_config) {
+        ALOGE("run_config is NULL!");
+        return false;
+    }
+
+    if (run_config->sample_format < AX_TTS_SAMPLE_FLOAT32 || run_config->sample_format > AX_TTS_SAMPLE_INT16_DITHER) {
+        ALOGE("Unsupported sample_format %d!", run_config->sample_format);
+        return false;
+    }
+    return true;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,12 +92,17 @@ AX_TTS_API AX_TTS_HANDLE AX_TTS_Init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG*
         return NULL;
     }
 
-    TTSInterface* handle = TTSFactory::create(tts_type, init_config);
-    if (!handle) {
+    TTSInterface* tts = TTSFactory::create(tts_type, init_config);
+    if (!tts) {
         ALOGE("Create tts failed!");
         return NULL;
     }
 
+    // 工作线程数与执行上下文数一致, 多了也只是等空闲的上下文
+    AxTtsHandle* handle = new AxTtsHandle();
+    handle->tts.reset(tts);
+    handle->num_workers = std::max(1, std::min(init_config->num_contexts, AX_TTS_MAX_CONTEXTS));
+
     return static_cast<AX_TTS_HANDLE>(handle);
 }
 
@@ -70,9 +119,15 @@ AX_TTS_API AX_TTS_HANDLE AX_TTS_Init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG*
  */
 AX_TTS_API void AX_TTS_Uninit(AX_TTS_HANDLE handle) {
     if (handle) {
-        auto interface = static_cast<TTSInterface*>(handle);
-        interface->uninit();
-        delete interface;
+        auto h = static_cast<AxTtsHandle*>(handle);
+        // 先停掉工作线程, 它们还在使用 tts; stop 返回前阻塞在 AX_TTS_Wait 中的线程都已返回,
+        // 之后才能析构队列
+        if (h->queue) {
+            h->queue->stop();
+        }
+        h->queue.reset();
+        h->tts->uninit();
+        delete h;
     }
 }
 
@@ -98,12 +153,11 @@ AX_TTS_API int AX_TTS_Run(AX_TTS_HANDLE handle,
         return -1;
     }
 
-    if (!run_config) {
-        ALOGE("run_config is NULL!");
+    if (!check_run_config(run_config)) {
         return -1;
     }
 
-    auto interface = static_cast<TTSInterface*>(handle);
+    auto interface = get_tts(handle);
     if (!interface->run(std::string(text), run_config, audio)) {
         ALOGE("Run tts failed!");
         return -1;
@@ -112,6 +166,458 @@ AX_TTS_API int AX_TTS_Run(AX_TTS_HANDLE handle,
     return 0;
 }
 
+/**
+ * @brief Perform speech generation from phonemes, skipping the text frontend
+ * 
+ * @param handle context handle
+ * @param phonemes UTF-8 IPA string
+ * @param run_config Config of generation
+ * @param audio Pointer to receive the allocated audio
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ */
+AX_TTS_API int AX_TTS_RunPhonemes(AX_TTS_HANDLE handle, 
+                   const char* phonemes, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audio) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!phonemes) {
+        ALOGE("phonemes is NULL!");
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    if (!get_tts(handle)->run_phonemes(std::string(phonemes), run_config, audio)) {
+        ALOGE("Run tts failed!");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Perform speech generation from token ids, skipping the text frontend
+ * 
+ * @param handle context handle
+ * @param tokens Token ids of vocab.txt, without the leading and trailing 0
+ * @param num_tokens Number of ids in tokens
+ * @param run_config Config of generation
+ * @param audio Pointer to receive the allocated audio
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ */
+AX_TTS_API int AX_TTS_RunTokens(AX_TTS_HANDLE handle, 
+                   const int* tokens, 
+                   int num_tokens,
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audio) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!tokens || num_tokens <= 0) {
+        ALOGE("tokens is NULL or num_tokens(%d) <= 0!", num_tokens);
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    std::vector<int> token_ids(tokens, tokens + num_tokens);
+    if (!get_tts(handle)->run_tokens(token_ids, run_config, audio)) {
+        ALOGE("Run tts failed!");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Perform speech generation into a caller-owned buffer
+ * 
+ * Audio is written straight into buffer as it is synthesized, no result
+ * struct is allocated and nothing has to be freed afterwards.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech
+ * @param run_config Config of generation
+ * @param buffer Caller-owned buffer receiving mono samples at
+ *               run_config->sample_rate in run_config->sample_format
+ *               (float or int16_t), may be NULL if buffer_len is 0
+ * @param buffer_len Capacity of buffer in samples
+ * @param num_samples Receives the number of samples of the whole utterance
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_BUFFER_TOO_SMALL if
+ *         *num_samples > buffer_len, other <0 = error)
+ * 
+ * @note On AX_TTS_ERR_BUFFER_TOO_SMALL the buffer holds the first buffer_len
+ *       samples and *num_samples is the required size, call again with a
+ *       buffer of at least that size to get the full audio.
+ */
+AX_TTS_API int AX_TTS_RunInto(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   void* buffer,
+                   int buffer_len,
+                   int* num_samples) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!text) {
+        ALOGE("text is NULL!");
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    if (!num_samples || buffer_len < 0 || (!buffer && buffer_len > 0)) {
+        ALOGE("Invalid output buffer!");
+        return -1;
+    }
+
+    auto interface = get_tts(handle);
+    if (!interface->run_into(std::string(text), run_config, buffer, buffer_len, num_samples)) {
+        ALOGE("Run tts into buffer failed!");
+        return -1;
+    }
+
+    if (*num_samples > buffer_len) {
+        ALOGW("Output buffer too small, %d samples required but %d given", *num_samples, buffer_len);
+        return AX_TTS_ERR_BUFFER_TOO_SMALL;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Perform speech generation and deliver audio chunk by chunk
+ * 
+ * The text is split into sentences, each sentence is synthesized and handed
+ * to the callback as soon as it is finished, so playback can start before
+ * the whole text is generated.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech
+ * @param run_config Config of generation
+ * @param callback Called once per finished chunk, in order
+ * @param user_data User pointer passed through to callback
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ * 
+ * @note Returning non-zero from callback stops synthesis, this is not an error.
+ */
+AX_TTS_API int AX_TTS_RunStream(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_STREAM_CALLBACK callback,
+                   void* user_data) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!text) {
+        ALOGE("text is NULL!");
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    if (!callback) {
+        ALOGE("callback is NULL!");
+        return -1;
+    }
+
+    auto interface = get_tts(handle);
+    if (!interface->run_stream(std::string(text), run_config, callback, user_data)) {
+        ALOGE("Run tts stream failed!");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Perform speech generation for many texts in one call
+ * 
+ * Texts are sorted by length and split into groups that run concurrently
+ * on the execution contexts of the handle (init_config->num_contexts), so
+ * the text frontend of one group overlaps the NPU work of another. Short
+ * sentences of different texts are packed into one model pass.
+ * 
+ * @param handle context handle
+ * @param texts Array of num_texts texts
+ * @param num_texts Number of texts
+ * @param run_config Config of generation, shared by all texts
+ * @param audios Array of num_texts pointers, audios[i] receives the
+ *               allocated audio of texts[i], or NULL if it failed
+ * 
+ * @return int Status code (0 = every text succeeded, <0 = at least one
+ *         audios[i] is NULL)
+ * 
+ * @note Every non-NULL audios[i] must be freed by the caller using free(),
+ *       also when an error is returned.
+ */
+AX_TTS_API int AX_TTS_RunBatch(AX_TTS_HANDLE handle, 
+                   const char** texts,
+                   int num_texts,
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audios) {
+    if (!audios || num_texts < 0) {
+        ALOGE("Invalid audios or num_texts!");
+        return -1;
+    }
+
+    // 调用者在出错时也会 free 非 NULL 的 audios[i], 先全部清空再做其它检查
+    for (int i = 0; i < num_texts; i++) {
+        audios[i] = NULL;
+    }
+
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!texts) {
+        ALOGE("Invalid texts!");
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    std::vector<std::string> text_list(num_texts);
+    for (int i = 0; i < num_texts; i++) {
+        if (!texts[i]) {
+            ALOGE("texts[%d] is NULL!", i);
+            return -1;
+        }
+        text_list[i] = texts[i];
+    }
+
+    // 每个文本完成时写到各自的位置, 不同文本可能在不同线程完成
+    std::atomic<int> failed{0};
+    get_tts(handle)->run_batch(text_list, run_config, [audios, &failed](size_t index, AX_TTS_AUDIO* audio) {
+        audios[index] = audio;
+        if (!audio)
+            failed++;
+    });
+
+    if (failed > 0) {
+        ALOGE("%d of %d texts failed!", failed.load(), num_texts);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Queue a speech generation request and return immediately
+ * 
+ * The request is synthesized by worker threads of the handle, requests
+ * submitted together overlap on the NPU.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech, copied before returning
+ * @param run_config Config of generation, copied before returning
+ * 
+ * @return AX_TTS_REQUEST_ID Id of the request (> 0), or -1 on error
+ * 
+ * @note Every submitted request must be finished with AX_TTS_Poll() or
+ *       AX_TTS_Wait(), otherwise its audio is only freed by AX_TTS_Uninit().
+ */
+AX_TTS_API AX_TTS_REQUEST_ID AX_TTS_Submit(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!text) {
+        ALOGE("text is NULL!");
+        return -1;
+    }
+
+    if (!check_run_config(run_config)) {
+        return -1;
+    }
+
+    return get_queue(handle)->submit(std::string(text), *run_config);
+}
+
+/**
+ * @brief Check whether a submitted request is finished, without blocking
+ * 
+ * @param handle context handle
+ * @param request_id Id returned by AX_TTS_Submit()
+ * @param audio Pointer to receive the allocated audio once finished
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_NOT_READY if still
+ *         queued or running, other <0 = error)
+ * 
+ * @note Any return value other than AX_TTS_ERR_NOT_READY finishes the
+ *       request and the id becomes invalid. The returned audio must be
+ *       freed by the caller using free().
+ */
+AX_TTS_API int AX_TTS_Poll(AX_TTS_HANDLE handle, 
+                   AX_TTS_REQUEST_ID request_id,
+                   AX_TTS_AUDIO** audio) {
+    return AX_TTS_Wait(handle, request_id, audio, 0);
+}
+
+/**
+ * @brief Block until a submitted request is finished or timeout expires
+ * 
+ * @param handle context handle
+ * @param request_id Id returned by AX_TTS_Submit()
+ * @param audio Pointer to receive the allocated audio once finished
+ * @param timeout_ms Max time to wait in milliseconds, <0 waits forever
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_NOT_READY on timeout,
+ *         other <0 = error)
+ * 
+ * @note Same ownership rules as AX_TTS_Poll().
+ */
+AX_TTS_API int AX_TTS_Wait(AX_TTS_HANDLE handle, 
+                   AX_TTS_REQUEST_ID request_id,
+                   AX_TTS_AUDIO** audio,
+                   int timeout_ms) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!audio) {
+        ALOGE("audio is NULL!");
+        return -1;
+    }
+
+    return get_queue(handle)->wait(request_id, audio, timeout_ms);
+}
+
+
+/**
+ * @brief Warm up a handle so the first real request runs at steady-state latency
+ * 
+ * @param handle context handle
+ * @param voices Names of the voices to preload, voices[0] is used for the
+ *               dummy passes
+ * @param num_voices Number of voices, at least 1
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ */
+AX_TTS_API int AX_TTS_Warmup(AX_TTS_HANDLE handle, 
+                   const char** voices,
+                   int num_voices) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!voices || num_voices <= 0) {
+        ALOGE("voices is NULL or num_voices(%d) <= 0!", num_voices);
+        return -1;
+    }
+
+    std::vector<std::string> voice_names;
+    for (int i = 0; i < num_voices; i++) {
+        if (!voices[i]) {
+            ALOGE("voices[%d] is NULL!", i);
+            return -1;
+        }
+        voice_names.emplace_back(voices[i]);
+    }
+
+    if (!get_tts(handle)->warmup(voice_names)) {
+        ALOGE("Warmup tts failed!");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Get per-stage latency and counters of a handle
+ * 
+ * @param handle context handle
+ * @param stats Receives the statistics
+ * @param reset Non-zero to clear the statistics after reading them
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ */
+AX_TTS_API int AX_TTS_GetStats(AX_TTS_HANDLE handle, 
+                   AX_TTS_STATS* stats,
+                   int reset) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!stats) {
+        ALOGE("stats is NULL!");
+        return -1;
+    }
+
+    get_tts(handle)->get_stats(stats, reset != 0);
+    return 0;
+}
+
+/**
+ * @brief Start recording a trace of the synthesis pipeline
+ * 
+ * @param handle context handle
+ * @param path Trace JSON file written by AX_TTS_StopTrace()
+ * 
+ * @return int Status code (0 = success, <0 = error or already tracing)
+ */
+AX_TTS_API int AX_TTS_StartTrace(AX_TTS_HANDLE handle, 
+                   const char* path) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    if (!path) {
+        ALOGE("path is NULL!");
+        return -1;
+    }
+
+    return get_tts(handle)->start_trace(path) ? 0 : -1;
+}
+
+/**
+ * @brief Stop tracing and write the Chrome trace event JSON file
+ * 
+ * @param handle context handle
+ * 
+ * @return int Status code (0 = success, <0 = not tracing or write failed)
+ */
+AX_TTS_API int AX_TTS_StopTrace(AX_TTS_HANDLE handle) {
+    if (!handle) {
+        ALOGE("handle is NULL!");
+        return -1;
+    }
+
+    return get_tts(handle)->stop_trace() ? 0 : -1;
+}
+
 #ifdef __cplusplus
 }
 #endif                   
\ No newline at end of file
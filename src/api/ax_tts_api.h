@@ -14,20 +14,46 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #define AX_TTS_API __attribute__((visibility("default")))
 
 #define AX_TTS_MAX_STR_LEN  32
+#define AX_TTS_MAX_CONTEXTS 8   // Upper bound of AX_TTS_INIT_CONFIG.num_contexts
+#define AX_TTS_MAX_G2P_WORKERS  8   // Upper bound of AX_TTS_INIT_CONFIG.num_g2p_workers
+
+// Error codes
+#define AX_TTS_ERR_BUFFER_TOO_SMALL     (-2)    // Output buffer of AX_TTS_RunInto() is too small
+#define AX_TTS_ERR_NOT_READY            (-3)    // Submitted request is still queued or running
+#define AX_TTS_ERR_INVALID_REQUEST      (-4)    // Unknown or already finished request id
+#define AX_TTS_ERR_CANCELLED            (-5)    // Queued request was dropped by AX_TTS_Uninit()
 
 // Supported TTS models
 enum AX_TTS_TYPE_E {
     AX_KOKORO = 0,
 };
 
+// Sample format of the output audio
+enum AX_TTS_SAMPLE_FORMAT_E {
+    AX_TTS_SAMPLE_FLOAT32 = 0,      // float in [-1, 1]
+    AX_TTS_SAMPLE_INT16 = 1,        // int16_t, rounded and saturated
+    AX_TTS_SAMPLE_INT16_DITHER = 2, // int16_t with +-1 LSB triangular dither
+};
+
 // TTS Init config
 typedef struct {
-    int max_seq_len;
+    int max_seq_len;    // Models compiled for every sequence length <= max_seq_len are loaded
     char model_path[AX_TTS_MAX_STR_LEN];
     char espeak_data_path[AX_TTS_MAX_STR_LEN];
+    int num_contexts;   // Number of requests one handle can run concurrently, 1 if <= 0.
+                        // Models are loaded once, every context only allocates its own IO buffers
+    int num_g2p_workers;    // Number of espeak worker processes forked by AX_TTS_Init(), 0 to run
+                            // espeak in the calling process. espeak is not reentrant, so without
+                            // workers the G2P of concurrent requests runs one at a time
+    int g2p_cache_words;    // Non-zero to cache espeak output per word (lowercased, surrounding
+                            // punctuation removed) instead of per punctuation segment. Repeated
+                            // words hit the cache, but espeak no longer sees the context, so weak
+                            // forms and sentence stress may differ from the default
 } AX_TTS_INIT_CONFIG;
 
 
@@ -38,6 +64,11 @@ typedef struct {
     int sample_rate;
     char voice[AX_TTS_MAX_STR_LEN];
     char language[AX_TTS_MAX_STR_LEN];
+    int sample_format;  // AX_TTS_SAMPLE_FORMAT_E, 0 (float32) if the config is zero-initialized
+    int pack_texts;     // Non-zero to let AX_TTS_RunBatch() pack short sentences of different texts
+                        // into one model pass. A pass uses the style vector of its longest sentence,
+                        // so packed audio differs from what AX_TTS_Run() gives for the same text.
+                        // 0 (the default) keeps every text identical to its standalone output
 } AX_TTS_RUN_CONFIG;
 
 // Speech audio
@@ -45,9 +76,66 @@ typedef struct {
     int sample_rate;
     int num_samples;
     int channels;
-    float data[];
+    float data[];       // num_samples samples in the sample_format of the run config,
+                        // int16_t for the int16 formats
 } AX_TTS_AUDIO;
 
+// Access AX_TTS_AUDIO.data as int16_t samples
+#define AX_TTS_AUDIO_S16(audio)     ((int16_t*)(audio)->data)
+
+// Id of a request queued by AX_TTS_Submit()
+typedef int64_t AX_TTS_REQUEST_ID;
+
+// Timed stages of a synthesis, index of AX_TTS_STATS.stages
+enum AX_TTS_STAGE_E {
+    AX_TTS_STAGE_CLEAN = 0,     // Text cleaner
+    AX_TTS_STAGE_NORMALIZE,     // Text normalizer
+    AX_TTS_STAGE_G2P,           // Grapheme to phoneme (espeak)
+    AX_TTS_STAGE_TOKENIZE,      // Phonemes to token ids
+    AX_TTS_STAGE_MODEL1,        // NPU, duration predictor
+    AX_TTS_STAGE_ALIGNMENT,     // Durations, alignment matrix and expanded features
+    AX_TTS_STAGE_MODEL2,        // NPU, F0 and ASR features
+    AX_TTS_STAGE_HAR,           // Harmonic source of the vocoder
+    AX_TTS_STAGE_MODEL3,        // NPU, decoder
+    AX_TTS_STAGE_ISTFT,         // Spectrum to waveform
+    AX_TTS_STAGE_REQUEST,       // Whole request, from text to its last sample
+    AX_TTS_STAGE_NUM,
+};
+
+// Latency of one stage since AX_TTS_Init() or the last reset
+typedef struct {
+    uint64_t count;     // Number of timed calls
+    float mean_ms;
+    float p50_ms;       // Percentiles are accurate to about 6%
+    float p95_ms;
+    float p99_ms;
+    float max_ms;
+} AX_TTS_STAGE_STATS;
+
+// Statistics of a handle, see AX_TTS_GetStats()
+typedef struct {
+    AX_TTS_STAGE_STATS stages[AX_TTS_STAGE_NUM];    // Indexed by AX_TTS_STAGE_E
+    uint64_t num_requests;  // Finished requests, including failed ones
+    uint64_t num_failed;
+    double audio_seconds;   // Total duration of the synthesized audio
+    float rtf;              // Real-time factor, summed request time / audio_seconds
+    int num_g2p_workers;    // G2P worker processes still running, crashed ones are not restarted
+    uint64_t g2p_cache_hits;    // espeak phoneme cache lookups, summed over the calling process
+    uint64_t g2p_cache_misses;  // and the G2P worker processes
+} AX_TTS_STATS;
+
+/**
+ * @brief Callback invoked by AX_TTS_RunStream() for every synthesized chunk
+ * 
+ * @param audio Audio of the finished chunk, owned by the library and only
+ *              valid until the callback returns
+ * @param is_last 1 if this is the last chunk of the text, otherwise 0
+ * @param user_data User pointer passed to AX_TTS_RunStream()
+ * 
+ * @return int 0 to continue, non-zero to stop the remaining synthesis
+ */
+typedef int (*AX_TTS_STREAM_CALLBACK)(const AX_TTS_AUDIO* audio, int is_last, void* user_data);
+
 
 /**
  * @brief Opaque handle type for TTS context
@@ -73,6 +161,9 @@ typedef void* AX_TTS_HANDLE;
  * 
  * @note The caller is responsible for calling AX_TTS_Uninit() to free
  *       resources when the handle is no longer needed.
+ * @note The run functions may be called from several threads on one handle,
+ *       up to init_config->num_contexts of them run concurrently and the
+ *       others wait for a free context.
  * @example
  *   // Initialize recognition with whisper tiny model
  *   AX_TTS_HANDLE handle = AX_TTS_Init(AX_KOKORO, "./models-ax650/");
@@ -90,6 +181,11 @@ AX_TTS_API AX_TTS_HANDLE AX_TTS_Init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG*
  * 
  * @warning After calling this function, the handle becomes invalid and
  *          should not be used in any subsequent API calls.
+ *          Requests submitted by AX_TTS_Submit() and not started yet are
+ *          dropped, threads already blocked in AX_TTS_Wait() on them return
+ *          AX_TTS_ERR_CANCELLED. Requests being synthesized are finished
+ *          first, and AX_TTS_Uninit() returns only after every blocked
+ *          AX_TTS_Wait() has returned. No new call may start meanwhile.
  */
 AX_TTS_API void AX_TTS_Uninit(AX_TTS_HANDLE handle);
 
@@ -111,6 +207,260 @@ AX_TTS_API int AX_TTS_Run(AX_TTS_HANDLE handle,
                    AX_TTS_RUN_CONFIG* run_config,
                    AX_TTS_AUDIO** audio);                
 
+/**
+ * @brief Perform speech generation from phonemes, skipping the text frontend
+ * 
+ * For callers that already phonemize (and cache) upstream. The phonemes are
+ * only mapped to token ids, espeak is not run and its global lock is not
+ * taken, so requests on different contexts do not serialize on it.
+ * 
+ * @param handle context handle
+ * @param phonemes UTF-8 IPA string as produced by the espeak G2P of this
+ *                 library, characters missing from vocab.txt are dropped
+ * @param run_config Config of generation
+ * @param audio Pointer to receive the allocated audio
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ * 
+ * @note Same ownership rules as AX_TTS_Run().
+ */
+AX_TTS_API int AX_TTS_RunPhonemes(AX_TTS_HANDLE handle, 
+                   const char* phonemes, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audio);
+
+/**
+ * @brief Perform speech generation from token ids, skipping the text frontend
+ * 
+ * @param handle context handle
+ * @param tokens Token ids of vocab.txt, without the 0 (pad) that starts and
+ *               ends every input, it is added by the library. Long inputs
+ *               are split into sentences like text is.
+ * @param num_tokens Number of ids in tokens
+ * @param run_config Config of generation
+ * @param audio Pointer to receive the allocated audio
+ * 
+ * @return int Status code (0 = success, <0 = error, e.g. an id missing
+ *         from vocab.txt)
+ * 
+ * @note Same ownership rules as AX_TTS_Run().
+ */
+AX_TTS_API int AX_TTS_RunTokens(AX_TTS_HANDLE handle, 
+                   const int* tokens, 
+                   int num_tokens,
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audio);
+
+/**
+ * @brief Perform speech generation into a caller-owned buffer
+ * 
+ * Audio is written straight into buffer as it is synthesized, no result
+ * struct is allocated and nothing has to be freed afterwards.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech
+ * @param run_config Config of generation
+ * @param buffer Caller-owned buffer receiving mono samples at
+ *               run_config->sample_rate in run_config->sample_format
+ *               (float or int16_t), may be NULL if buffer_len is 0
+ * @param buffer_len Capacity of buffer in samples
+ * @param num_samples Receives the number of samples of the whole utterance
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_BUFFER_TOO_SMALL if
+ *         *num_samples > buffer_len, other <0 = error)
+ * 
+ * @note On AX_TTS_ERR_BUFFER_TOO_SMALL the buffer holds the first buffer_len
+ *       samples and *num_samples is the required size, call again with a
+ *       buffer of at least that size to get the full audio.
+ */
+AX_TTS_API int AX_TTS_RunInto(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   void* buffer,
+                   int buffer_len,
+                   int* num_samples);
+
+/**
+ * @brief Perform speech generation and deliver audio chunk by chunk
+ * 
+ * The text is split into sentences, each sentence is synthesized and handed
+ * to the callback as soon as it is finished, so playback can start before
+ * the whole text is generated.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech
+ * @param run_config Config of generation
+ * @param callback Called once per finished chunk, in order
+ * @param user_data User pointer passed through to callback
+ * 
+ * @return int Status code (0 = success, <0 = error)
+ * 
+ * @note Returning non-zero from callback stops synthesis, this is not an error.
+ */
+AX_TTS_API int AX_TTS_RunStream(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_STREAM_CALLBACK callback,
+                   void* user_data);
+
+/**
+ * @brief Perform speech generation for many texts in one call
+ * 
+ * Texts are sorted by length and split into groups that run concurrently
+ * on the execution contexts of the handle (init_config->num_contexts), so
+ * the text frontend of one group overlaps the NPU work of another. With
+ * run_config->pack_texts set, short sentences of different texts are packed
+ * into one model pass; packed audio then depends on the texts it was packed
+ * with and differs from the standalone output of AX_TTS_Run().
+ * 
+ * @param handle context handle
+ * @param texts Array of num_texts texts
+ * @param num_texts Number of texts
+ * @param run_config Config of generation, shared by all texts
+ * @param audios Array of num_texts pointers, audios[i] receives the
+ *               allocated audio of texts[i], or NULL if it failed
+ * 
+ * @return int Status code (0 = every text succeeded, <0 = at least one
+ *         audios[i] is NULL)
+ * 
+ * @note Every non-NULL audios[i] must be freed by the caller using free(),
+ *       also when an error is returned. When audios is not NULL, all of
+ *       its entries are set to NULL before any other argument is checked.
+ */
+AX_TTS_API int AX_TTS_RunBatch(AX_TTS_HANDLE handle, 
+                   const char** texts,
+                   int num_texts,
+                   AX_TTS_RUN_CONFIG* run_config,
+                   AX_TTS_AUDIO** audios);
+
+/**
+ * @brief Queue a speech generation request and return immediately
+ * 
+ * The request is synthesized by worker threads of the handle, requests
+ * submitted together overlap on the NPU.
+ * 
+ * @param handle context handle
+ * @param text Text input to generate speech, copied before returning
+ * @param run_config Config of generation, copied before returning
+ * 
+ * @return AX_TTS_REQUEST_ID Id of the request (> 0), or -1 on error
+ * 
+ * @note Every submitted request must be finished with AX_TTS_Poll() or
+ *       AX_TTS_Wait(), otherwise its audio is only freed by AX_TTS_Uninit().
+ */
+AX_TTS_API AX_TTS_REQUEST_ID AX_TTS_Submit(AX_TTS_HANDLE handle, 
+                   const char* text, 
+                   AX_TTS_RUN_CONFIG* run_config);
+
+/**
+ * @brief Check whether a submitted request is finished, without blocking
+ * 
+ * @param handle context handle
+ * @param request_id Id returned by AX_TTS_Submit()
+ * @param audio Pointer to receive the allocated audio once finished
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_NOT_READY if still
+ *         queued or running, other <0 = error)
+ * 
+ * @note Any return value other than AX_TTS_ERR_NOT_READY finishes the
+ *       request and the id becomes invalid. The returned audio must be
+ *       freed by the caller using free().
+ */
+AX_TTS_API int AX_TTS_Poll(AX_TTS_HANDLE handle, 
+                   AX_TTS_REQUEST_ID request_id,
+                   AX_TTS_AUDIO** audio);
+
+/**
+ * @brief Block until a submitted request is finished or timeout expires
+ * 
+ * @param handle context handle
+ * @param request_id Id returned by AX_TTS_Submit()
+ * @param audio Pointer to receive the allocated audio once finished
+ * @param timeout_ms Max time to wait in milliseconds, <0 waits forever
+ * 
+ * @return int Status code (0 = success, AX_TTS_ERR_NOT_READY on timeout,
+ *         AX_TTS_ERR_CANCELLED if the request was dropped by
+ *         AX_TTS_Uninit(), other <0 = error)
+ * 
+ * @note Same ownership rules as AX_TTS_Poll().
+ */
+AX_TTS_API int AX_TTS_Wait(AX_TTS_HANDLE handle, 
+                   AX_TTS_REQUEST_ID request_id,
+                   AX_TTS_AUDIO** audio,
+                   int timeout_ms);
+
+/**
+ * @brief Warm up a handle so the first real request runs at steady-state latency
+ *
+ * Preloads the given voices, runs the text frontend once (espeak loads its
+ * dictionaries on first use) and runs one dummy pass through every model
+ * bucket on every execution context, including HAR and iSTFT. Call it once
+ * after AX_TTS_Init() and before serving requests.
+ *
+ * @param handle context handle
+ * @param voices Names of the voices to preload, voices[0] is used for the
+ *               dummy passes
+ * @param num_voices Number of voices, at least 1
+ *
+ * @return int Status code (0 = success, <0 = error, e.g. a missing voice)
+ *
+ * @note Blocks until every context is free, concurrent calls run one after
+ *       another. The dummy passes are not counted by AX_TTS_GetStats(),
+ *       statistics of requests running meanwhile are kept.
+ */
+AX_TTS_API int AX_TTS_Warmup(AX_TTS_HANDLE handle,
+                   const char** voices,
+                   int num_voices);
+
+/**
+ * @brief Get per-stage latency and counters of a handle
+ *
+ * Every run function of the handle records how long the text frontend,
+ * each NPU model, the alignment, HAR and iSTFT take, so a slowdown can be
+ * traced to espeak, the NPU or the CPU postprocess. Recording is lock-free
+ * and always on.
+ *
+ * @param handle context handle
+ * @param stats Receives the statistics
+ * @param reset Non-zero to clear the statistics after reading them
+ *
+ * @return int Status code (0 = success, <0 = error)
+ *
+ * @note May be called from any thread while requests are running, the
+ *       numbers are then a close but not exact snapshot.
+ */
+AX_TTS_API int AX_TTS_GetStats(AX_TTS_HANDLE handle,
+                   AX_TTS_STATS* stats,
+                   int reset);
+
+/**
+ * @brief Start recording a trace of the synthesis pipeline
+ *
+ * Every stage timed by AX_TTS_GetStats(), the waits for a free context or
+ * the text frontend, each model pass and the delivery of its audio are
+ * recorded with thread, request, chunk and pass ids. Open the file written
+ * by AX_TTS_StopTrace() in chrome://tracing or ui.perfetto.dev to see how
+ * CPU and NPU work of concurrent requests overlap.
+ *
+ * @param handle context handle
+ * @param path Trace JSON file written by AX_TTS_StopTrace()
+ *
+ * @return int Status code (0 = success, <0 = error or already tracing)
+ *
+ * @note Tracing is off by default and costs one atomic load per stage then.
+ */
+AX_TTS_API int AX_TTS_StartTrace(AX_TTS_HANDLE handle,
+                   const char* path);
+
+/**
+ * @brief Stop tracing and write the Chrome trace event JSON file
+ *
+ * @param handle context handle
+ *
+ * @return int Status code (0 = success, <0 = not tracing or write failed)
+ */
+AX_TTS_API int AX_TTS_StopTrace(AX_TTS_HANDLE handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,7 +27,8 @@ AxModelRunner::AxModelRunner():
     m_pIOinfo(nullptr),
     m_input_num(0),
     m_output_num(0),
-    m_loaded(false) {
+    m_loaded(false),
+    m_owns_handle(false) {
 
     memset(&m_io, 0, sizeof(AX_ENGINE_IO_T));
 }
@@ -68,6 +69,8 @@ int AxModelRunner::load_model(const char* model_path, IO_BUFFER_STRATEGY_T strat
         return ret;
     }
 
+    m_owns_handle = true;
+    m_run_mutex = std::make_shared<std::mutex>();
     m_strategy = strategy;
     ret = _prepare_io();
     if (0 != ret) {
@@ -83,12 +86,38 @@ int AxModelRunner::load_model(const char* model_path, IO_BUFFER_STRATEGY_T strat
     return ret;
 }
 
+int AxModelRunner::attach_model(AxModelRunner& owner) {
+    if (!owner.m_loaded) {
+        ALOGE("owner model is not loaded!");
+        return -1;
+    }
+
+    m_handle = owner.m_handle;
+    m_owns_handle = false;
+    m_run_mutex = owner.m_run_mutex;
+    m_strategy = owner.m_strategy;
+
+    int ret = _prepare_io();
+    if (0 != ret) {
+        ALOGE("_prepare_io failed! ret=0x%x", ret);
+        _free_io();
+        m_handle = 0;
+        return ret;
+    }
+
+    m_loaded = true;
+    return ret;
+}
+
 int AxModelRunner::unload_model(void) {
     int ret = 0;
     if (m_handle != 0) {
-        ALOGD("Detroy engine handle");
-        ret = AX_ENGINE_DestroyHandle(m_handle);
+        if (m_owns_handle) {
+            ALOGD("Detroy engine handle");
+            ret = AX_ENGINE_DestroyHandle(m_handle);
+        }
         m_handle = 0;
+        m_loaded = false;
 
         _free_io();
     }
@@ -96,12 +125,18 @@ int AxModelRunner::unload_model(void) {
 }
 
 int AxModelRunner::run(void) {
+    if (!m_loaded) {
+        ALOGE("model is not loaded!");
+        return -1;
+    }
+
     if (m_strategy == IO_BUFFER_STRATEGY_CACHED) {
         for (int index = 0; index < m_input_num; index++) {
             _cache_io_flush(m_io.pInputs[index]);
         }
     }
 
+    std::lock_guard<std::mutex> lock(*m_run_mutex);
     int ret = AX_ENGINE_RunSync(m_handle, &m_io);
     if (0 != ret) {
         ALOGE("AX_ENGINE_RunSync failed! ret=0x%x", ret);
@@ -178,6 +213,22 @@ void* AxModelRunner::get_output_ptr(int index) {
     return m_io.pOutputs[index].pVirAddr;
 }
 
+int AxModelRunner::share_input_with_output(int index, AxModelRunner& other, int other_index) {
+    if (other_index < 0 || other_index >= other.m_output_num) {
+        ALOGE("other output index(%d) exceed output_num(%d)", other_index, other.m_output_num);
+        return -1;
+    }
+    return _share_input(index, other.m_io.pOutputs[other_index]);
+}
+
+int AxModelRunner::share_input_with_input(int index, AxModelRunner& other, int other_index) {
+    if (other_index < 0 || other_index >= other.m_input_num) {
+        ALOGE("other input index(%d) exceed input_num(%d)", other_index, other.m_input_num);
+        return -1;
+    }
+    return _share_input(index, other.m_io.pInputs[other_index]);
+}
+
 AX_U64 AxModelRunner::get_input_phy_addr(int index) {
     return m_io.pInputs[index].phyAddr;
 }
@@ -237,6 +288,7 @@ int AxModelRunner::_prepare_io() {
     m_io.nOutputSize = m_pIOinfo->nOutputSize;
 
     m_io.pInputs = new AX_ENGINE_IO_BUFFER_T[m_pIOinfo->nInputSize];
+    m_input_shared.assign(m_pIOinfo->nInputSize, false);
     m_io.pOutputs = new AX_ENGINE_IO_BUFFER_T[m_pIOinfo->nOutputSize];
 
     for (int i = 0; i < m_pIOinfo->nInputSize; i++) {
@@ -266,7 +318,7 @@ int AxModelRunner::_prepare_io() {
 
 void AxModelRunner::_free_io() {
     for (size_t i = 0; i < m_io.nInputSize; i++) {
-        if (0 != m_io.pInputs[i].phyAddr)
+        if (0 != m_io.pInputs[i].phyAddr && !m_input_shared[i])
             AX_SYS_MemFree(m_io.pInputs[i].phyAddr, m_io.pInputs[i].pVirAddr);
     }
 
@@ -278,6 +330,7 @@ void AxModelRunner::_free_io() {
     delete[] m_io.pInputs;
     delete[] m_io.pOutputs;
     memset(&m_io, 0, sizeof(AX_ENGINE_IO_T));
+    m_input_shared.clear();
 }
 
 int AxModelRunner::_alloc_io_buffer(AX_ENGINE_IO_BUFFER_T& buffer, 
@@ -304,4 +357,23 @@ void AxModelRunner::_cache_io_flush(AX_ENGINE_IO_BUFFER_T &buffer) {
     if (buffer.phyAddr != 0) {
         AX_SYS_MflushCache(buffer.phyAddr, buffer.pVirAddr, buffer.nSize);
     }
+}
+
+int AxModelRunner::_share_input(int index, const AX_ENGINE_IO_BUFFER_T &buffer) {
+    if (index < 0 || index >= m_input_num) {
+        ALOGE("index(%d) exceed input_num(%d)", index, m_input_num);
+        return -1;
+    }
+
+    if (buffer.nSize != m_io.pInputs[index].nSize) {
+        ALOGE("input[%d] size %d mismatch shared buffer size %d", index, m_io.pInputs[index].nSize, buffer.nSize);
+        return -1;
+    }
+
+    if (!m_input_shared[index] && 0 != m_io.pInputs[index].phyAddr)
+        AX_SYS_MemFree(m_io.pInputs[index].phyAddr, m_io.pInputs[index].pVirAddr);
+
+    m_io.pInputs[index] = buffer;
+    m_input_shared[index] = true;
+    return 0;
 }
\ No newline at end of file
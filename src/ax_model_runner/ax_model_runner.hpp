@@ -11,6 +11,8 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <mutex>
 
 #include "ax_engine_api.h"
 #include "utils/ax_engine_guard.hpp"
@@ -28,6 +30,10 @@ public:
 
     int load_model(const char* model_path, IO_BUFFER_STRATEGY_T strategy = IO_BUFFER_STRATEGY_CACHED);
 
+    // 复用 owner 已加载的模型, 只分配自己的 IO 缓冲, 多个执行上下文共用一份权重
+    // owner 必须比本对象后卸载, 同一模型的 run 相互串行
+    int attach_model(AxModelRunner& owner);
+
     int unload_model(void);
 
     int run(void);
@@ -48,6 +54,20 @@ public:
     void* get_input_ptr(int index);
     void* get_output_ptr(int index);
 
+    // 直接读写 CMM 缓冲, 避免 set_inputs/get_outputs 的拷贝
+    template <typename T>
+    inline T* get_input_data(int index) {
+        return static_cast<T*>(get_input_ptr(index));
+    }
+    template <typename T>
+    inline T* get_output_data(int index) {
+        return static_cast<T*>(get_output_ptr(index));
+    }
+
+    // 让本模型的输入直接使用另一个模型的输入/输出缓冲, 大小必须一致
+    int share_input_with_output(int index, AxModelRunner& other, int other_index);
+    int share_input_with_input(int index, AxModelRunner& other, int other_index);
+
     AX_U64 get_input_phy_addr(int index);
     AX_U64 get_output_phy_addr(int index);
 
@@ -66,6 +86,7 @@ private:
     int _alloc_io_buffer(AX_ENGINE_IO_BUFFER_T &buffer, 
             const AX_ENGINE_IOMETA_T &meta, IO_BUFFER_STRATEGY_T strategy);
     void _cache_io_flush(AX_ENGINE_IO_BUFFER_T &buffer);        
+    int _share_input(int index, const AX_ENGINE_IO_BUFFER_T &buffer);
     
 private:
     AX_ENGINE_HANDLE m_handle;
@@ -76,6 +97,9 @@ private:
     IO_BUFFER_STRATEGY_T m_strategy;
     std::vector<std::string> m_input_names;
     std::vector<std::string> m_output_names;
+    std::vector<bool> m_input_shared;   // 共享自其它模型的输入缓冲, 不由本模型释放
     bool m_loaded;
+    bool m_owns_handle;                         // attach_model 得到的句柄不由本对象销毁
+    std::shared_ptr<std::mutex> m_run_mutex;    // 同一个 AX_ENGINE 句柄的所有 runner 共用
     AxEngineGuard m_engine_guard;
 };
@@ -8,52 +8,276 @@
  *
  **************************************************************************************************/
 #include <map>
+#include <set>
 #include <fstream>
 #include <stdio.h>
+#include <cstring>
+#include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 #include "tts/kokoro.hpp"
 #include "tts/tts_frontend.hpp"
+#include "tts/tts_stats.hpp"
+#include "utils/g2p/Punctuator.hpp"
 #include "utils/logger.h"
 #include "utils/memory_utils.hpp"
 #include "ax_model_runner/ax_model_runner.hpp"
+#include "tts/kokoro_har.hpp"
+#ifdef WITH_ONNXRUNTIME
 #include "onnxruntime_cxx_api.h"
-#include "utils/librosa/eigen3/Eigen/Dense"
-#include "utils/librosa/librosa.h"
+#endif
+#include "utils/small_istft.hpp"
+#include "utils/spectrum_kernel.hpp"
+#include "utils/pcm_convert.hpp"
 
 // Preprocess parameters
 #define MAX_PHONEME_LENGTH   510 // max position embedding - 2
-#define FIXED_SEQ_LEN    96
+#define SEQ_LEN_BUCKETS  {32, 64, 96, 128, 192, 256}   // 按这些序列长度查找编译好的模型
 #define N_FFT  20
 #define HOP_LENGTH  5
-#define DOUBLE_INPUT_THRESHOLD  32  // 输入长度小于此值时复制一倍,适配短文本
+#define MODEL_SAMPLE_RATE   24000   // Kokoro 声码器的采样率, HAR 的正弦源按它生成
+#define DOUBLE_INPUT_RATIO  3  // 输入长度不超过序列长度的 1/DOUBLE_INPUT_RATIO 时复制一倍,适配短文本
+#define PACK_MAX_ITEMS  4   // 一次推理最多拼接几个请求的短块
+#define BATCH_GROUP_SIZE    16  // run_batch 每组的文本数, 一组占用一个执行上下文
 #define STYLE_DIM   256
+#define SENTENCE_END_MARKS  ".!?…"  // 流式输出时按这些标点切分句子
+#define CROSSFADE_DURATION  0.01f   // 相邻块之间交叉淡化的时长(秒)
 
 #define DEFAULT_SPEED   1.0f
 #define DEFAULT_FADE_OUT    0.05f
 #define DEFAULT_PAUSE   0.05f
 
+// 预热用的文本, 带数字和标点, 让前端的各个分支都走一遍
+#define WARMUP_TEXT "Hello, this is a warm-up sentence: 1, 2, 3. Is everything ready?"
+
 
 using namespace std;
 
-typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> DynMat;
+// Called with the audio of every finished chunk, return false to stop
+typedef std::function<bool(std::vector<float>& audio, bool is_last)> ChunkHandler;
 
-typedef std::vector<std::vector<std::complex<float>>> FFT_RESULT;
+// 请求的一块在 SynthesisItem::tokens 中的位置, 形如 [0, ..., 0]
+struct ChunkSpan {
+    size_t offset;
+    int len;
+};
 
-// Helper functions
-static std::vector<float> sigmoid(const std::vector<float>& x) {
-    std::vector<float> result(x.size());
-    for (int i = 0; i < x.size(); i++) {
-        result[i] = 1.0f / (1.0f + expf(-x[i]));
+// 一个待合成的请求
+struct SynthesisItem {
+    std::vector<int> input_ids;             // 前端的输出, 形如 [0, ..., 0]
+    std::vector<int> tokens;                // 各块首尾相接, 复用上一个请求的容量
+    std::vector<ChunkSpan> chunks;          // 按句切分后的输入
+    const ChunkHandler* on_chunk;           // 调用者持有, 合成结束前一直有效
+    std::vector<float> tail;                // 交叉淡化保留的尾部
+    std::vector<float> slice;               // 不在拼接开头的块, 从整段音频中拷出
+    size_t next_chunk;                      // 下一个要交付的块
+    std::map<size_t, std::vector<float>> parked;    // 按长度规划时先于前面的块完成的块
+    bool stopped;                           // 已交付最后一块或调用者要求停止
+    TTSStats::Clock::time_point start;      // 开始跑前端的时间, 统计请求耗时
+    size_t num_samples;                     // 已交付的样本数
+    int64_t request_id;                     // 追踪事件中的请求号
+};
+
+// 一个请求的输入: 文本跑完整前端, 音素只转换成 token, token 直接使用
+struct SynthesisInput {
+    enum Type { TEXT, PHONEMES, TOKENS };
+
+    explicit SynthesisInput(const std::string& text, Type type = TEXT):
+        type(type), str(&text), tokens(nullptr) {}
+    explicit SynthesisInput(const std::vector<int>& tokens):
+        type(TOKENS), str(nullptr), tokens(&tokens) {}
+
+    Type type;
+    const std::string* str;             // TEXT, PHONEMES
+    const std::vector<int>* tokens;     // TOKENS, 不含首尾补的 0
+};
+
+// 模型之间传递的张量, 不能共享 CMM 缓冲时在运行 dst 前拷贝
+struct TensorLink {
+    AxModelRunner* src;
+    int src_index;
+    bool src_is_output;
+    AxModelRunner* dst;
+    int dst_index;
+};
+
+// 按同一序列长度编译的一组 model1/2/3
+struct KokoroBucket {
+    int seq_len;
+    AxModelRunner model1, model2, model3;
+    std::vector<int> duration_shape, d_shape, aln_shape, F0_pred_shape, har_shape, x_shape;
+    size_t x_size;
+    std::vector<TensorLink> copy_links;
+};
+
+// 一次推理中拼接的一段输入, 对应某个请求的一块
+struct PackSegment {
+    int item;                       // 所属请求, -1 表示为适配短文本复制的输入, 输出丢弃
+    int chunk;                      // 在请求中的块序号
+    bool is_last;                   // 是请求的最后一块
+    int offset;                     // 在模型输入中的位置
+    int len;
+    int begin_frame, end_frame;     // 按 pred_dur 得到的帧范围
+    size_t begin_sample, end_sample;    // 在 ChunkJob::audio 中的范围
+};
+
+// model3 的前几个输入与 model1/model2 共享缓冲: asr, F0_pred, N_pred, ref_s, 见 link_bucket_
+#define MODEL3_SHARED_INPUTS    4
+#define MODEL3_HAR_INPUT        4
+
+// NPU 阶段的输出, 交给 CPU 后处理线程转换成音频
+struct ChunkJob {
+    int64_t pass_id;                // 追踪事件中的推理批次号
+    KokoroBucket* bucket;           // 所用的一组模型
+    int seq_len;                    // 所用模型的序列长度
+    int num_frames;                 // 频谱帧数
+    std::vector<float> x;           // model3 输出的频谱
+    int actual_len;                 // 去掉 padding 后的输入长度
+    int total_frames;
+    int fade_samples;               // 请求最后一块末尾的淡出长度
+    std::vector<PackSegment> segments;
+    std::vector<float> audio;       // 整个输入的音频, 按 segments 切分
+
+    // 流水线中下一个 pass 的 model1/model2 先于这个 pass 的 model3 运行, 会覆盖共享的缓冲
+    std::vector<float> f0;          // model2 输出的 F0_pred, HAR 在另一线程读取
+    std::vector<float> har;         // HAR 的结果, 运行 model3 前写回它的输入
+    std::vector<uint8_t> model3_inputs; // model3 与 model1/model2 共享的输入
+};
+
+// 每个执行上下文一份的临时缓冲, init 时按模型 IO 形状一次性分配, 之后的 run 只复用
+// 随输入长度变化的(各请求的 token, pass 规划)增长到见过的最长输入后也不再分配
+struct KokoroWorkspace {
+    std::vector<int> input_ids;         // 补齐/复制后的模型输入
+    std::vector<float> ref_s;
+    std::vector<int> pred_dur;
+    std::vector<size_t> sort_idx;       // 缩减帧数时的排序下标
+    ChunkJob jobs[3];                   // 流水线中 model1/model2, HAR/model3 和后处理各用一个
+    std::vector<float> spec_real, spec_imag;    // iSTFT 输入, [N_FFT/2+1, num_frames]
+    utils::SmallISTFT istft{N_FFT, HOP_LENGTH};
+    std::vector<SynthesisItem> items;   // 本次合成的请求, 单个文本时只有一个
+    std::vector<PackSegment> plan;      // 规划好的所有块, 每个 pass 是其中连续的一段
+    std::vector<size_t> pass_begin;     // 各 pass 在 plan 中的起点, 末尾多一个终点
+    std::vector<float> audio;           // run() 拼接整段音频
+
+    void reserve(int max_seq_len, size_t max_x_size, int max_num_frames, int max_audio_len,
+                 size_t max_f0_size, size_t max_har_size, size_t max_model3_inputs) {
+        input_ids.reserve(max_seq_len);
+        ref_s.resize(STYLE_DIM);
+        pred_dur.reserve(max_seq_len);
+        sort_idx.reserve(max_seq_len);
+        for (auto& job : jobs) {
+            job.x.reserve(max_x_size);
+            job.segments.reserve(PACK_MAX_ITEMS + 1);
+            job.audio.reserve(max_audio_len);
+            job.f0.reserve(max_f0_size);
+            job.har.reserve(max_har_size);
+            job.model3_inputs.reserve(max_model3_inputs);
+        }
+
+        int half_n_fft = N_FFT / 2 + 1;
+        spec_real.reserve(half_n_fft * max_num_frames);
+        spec_imag.reserve(half_n_fft * max_num_frames);
+        items.resize(1);
+        items[0].tail.reserve(max_audio_len);
+        audio.reserve(max_audio_len);
+    }
+};
+
+// 流水线中的一级, 在常驻线程中对提交的 job 运行 handler, 不用每个 pass 创建线程
+// 同一时刻只处理一个 job, 提交下一个之前要先 wait
+class PipelineStage {
+public:
+    typedef std::function<bool(ChunkJob& job)> Handler;
+
+    explicit PipelineStage(Handler handler):
+        handler_(std::move(handler)), thread_(&PipelineStage::loop_, this) {}
+
+    ~PipelineStage() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void submit(ChunkJob* job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = job;
+            busy_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // 等待提交的 job 完成, 返回 handler 的结果
+    bool wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !busy_; });
+        return ok_;
+    }
+
+private:
+    void loop_() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return quit_ || job_; });
+            if (!job_)
+                return;
+
+            ChunkJob* job = job_;
+            job_ = nullptr;
+            lock.unlock();
+            bool ok = handler_(*job);
+            lock.lock();
+            ok_ = ok;
+            busy_ = false;
+            cv_.notify_all();
+        }
     }
-    return result;
+
+private:
+    Handler handler_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    ChunkJob* job_ = nullptr;
+    bool busy_ = false;
+    bool ok_ = true;
+    bool quit_ = false;
+    std::thread thread_;        // 最后初始化, 启动时其它成员已经就绪
+};
+
+// 一次请求独占的执行上下文. 模型权重只加载一份, 每个上下文只有自己的 IO 缓冲和工作区
+struct KokoroContext {
+    std::vector<std::unique_ptr<KokoroBucket>> buckets;
+    KokoroWorkspace workspace;
+    KokoroHar har{MODEL_SAMPLE_RATE, N_FFT, HOP_LENGTH};
+    std::string voice_name;
+    std::shared_ptr<const std::vector<float>> voice;    // [MAX_PHONEME_LENGTH, STYLE_DIM]
+    std::vector<float> stream_buf;
+    // 流水线中与 NPU 并行的两级, 最先析构, 线程退出后才释放工作区
+    std::unique_ptr<PipelineStage> har_stage;
+    std::unique_ptr<PipelineStage> post_stage;
+    bool warming = false;   // 预热中, 耗时不计入统计
+};
+
+// Helper functions
+static inline float sigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
 }
 
 template <typename T>
-vector<size_t> argsort(const vector<T> &v, int len, bool reverse) {
+void argsort(const vector<T> &v, int len, bool reverse, vector<size_t>& idx) {
     // initialize original index locations
-    vector<size_t> idx(len);
+    idx.resize(len);
     iota(idx.begin(), idx.end(), 0);
 
     // sort indexes based on comparing values in v
@@ -66,18 +290,6 @@ vector<size_t> argsort(const vector<T> &v, int len, bool reverse) {
     else
         stable_sort(idx.begin(), idx.end(),
             [&v](size_t i1, size_t i2) {return v[i1] > v[i2];});
-
-    return idx;
-}
-
-template <typename T>
-vector<T> np_repeat(const vector<T> &v, const vector<int>& times) {
-    vector<T> result;
-    for (size_t i = 0; i < times.size(); i++) {
-        for (int n = 0; n < times[i]; n++)
-            result.push_back(v[i]);
-    }
-    return result;
 }
 
 template <typename T>
@@ -93,6 +305,24 @@ std::vector<T> linspace(T a, T b, size_t N) {
 
 
 class Kokoro::Impl {
+    // 在作用域内独占一个执行上下文, 全部被占用时等待
+    class ContextLease {
+    public:
+        explicit ContextLease(Impl& impl):
+            impl_(impl), ctx_(impl.acquire_context_()) {}
+        ~ContextLease() { impl_.release_context_(ctx_); }
+
+        ContextLease(const ContextLease&) = delete;
+        ContextLease& operator=(const ContextLease&) = delete;
+
+        KokoroContext& operator*() const { return *ctx_; }
+        KokoroContext* operator->() const { return ctx_; }
+
+    private:
+        Impl& impl_;
+        KokoroContext* ctx_;
+    };
+
 public:
     Impl() = default;
     ~Impl() {
@@ -100,8 +330,6 @@ public:
     }
 
     bool init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG* init_config) {
-        max_seq_len_ = init_config->max_seq_len;
-
         std::string model_path(init_config->model_path);
         std::string vocab_path = model_path + "/vocab.txt";
         voice_path_ = model_path + "/voices/";
@@ -115,94 +343,831 @@ public:
             return false;
         }
 
+        // 前端最先初始化: g2p worker 在加载模型之前 fork, 不继承 NPU 的资源
         TTSFrontendConfig frontend_config;
         sprintf(frontend_config.espeak_data_path, "%s", init_config->espeak_data_path);
+        frontend_config.num_g2p_workers = init_config->num_g2p_workers;
+        frontend_config.g2p_cache_words = init_config->g2p_cache_words;
+        if (frontend_config.num_g2p_workers > AX_TTS_MAX_G2P_WORKERS) {
+            ALOGW("num_g2p_workers %d exceed %d, clamp to it", frontend_config.num_g2p_workers, AX_TTS_MAX_G2P_WORKERS);
+            frontend_config.num_g2p_workers = AX_TTS_MAX_G2P_WORKERS;
+        }
 
         if (!frontend_.init(frontend_config)) {
             ALOGE("Init tts frontend failed!");
             return false;
         }
 
-        if (!load_models_(model_path)) {
+        // 未设置(0)时只有一个上下文, 与之前一个句柄同时只能跑一个请求的行为一致
+        int num_contexts = init_config->num_contexts;
+        if (num_contexts <= 0) {
+            num_contexts = 1;
+        } else if (num_contexts > AX_TTS_MAX_CONTEXTS) {
+            ALOGW("num_contexts %d exceed %d, clamp to it", num_contexts, AX_TTS_MAX_CONTEXTS);
+            num_contexts = AX_TTS_MAX_CONTEXTS;
+        }
+
+        // 第一个上下文加载模型, 其余的复用它的模型句柄, 只分配 IO 缓冲
+        auto owner = std::make_unique<KokoroContext>();
+        if (!load_models_(model_path, init_config->max_seq_len, owner->buckets)) {
             ALOGE("Load models failed!");
             return false;
         }
+        contexts_.emplace_back(std::move(owner));
 
-        // Prepare model outputs
-        duration_.resize(model1_.get_output_size(0) / sizeof(float));
-        d_.resize(model1_.get_output_size(1) / sizeof(float));
+        for (int i = 1; i < num_contexts; i++) {
+            auto ctx = clone_context_(*contexts_[0]);
+            if (!ctx) {
+                ALOGE("Create execution context %d failed!", i);
+                return false;
+            }
+            contexts_.emplace_back(std::move(ctx));
+        }
 
-        // F0_pred, N_pred, asr = outputs2
-        F0_pred_.resize(model2_.get_output_size(0) / sizeof(float));
-        N_pred_.resize(model2_.get_output_size(1) / sizeof(float));
-        asr_.resize(model2_.get_output_size(2) / sizeof(float));
+        // 最长的一组模型决定了单块输入的最大长度
+        KokoroBucket& largest = *contexts_[0]->buckets.back();
+        max_seq_len_ = largest.seq_len;
+        ALOGI("Loaded %d model buckets, max_seq_len=%d, %d execution contexts", 
+            (int)contexts_[0]->buckets.size(), max_seq_len_, num_contexts);
+
+        int max_num_frames = largest.x_shape[2];
+        size_t max_f0_size = largest.model2.get_output_size(0) / sizeof(float);
+        size_t max_har_size = largest.model3.get_input_size(MODEL3_HAR_INPUT) / sizeof(float);
+        size_t max_model3_inputs = 0;
+        for (int k = 0; k < MODEL3_SHARED_INPUTS; k++) {
+            max_model3_inputs += largest.model3.get_input_size(k);
+        }
+        for (auto& ctx : contexts_) {
+            ctx->workspace.reserve(max_seq_len_, largest.x_size, max_num_frames, max_num_frames * HOP_LENGTH,
+                max_f0_size, max_har_size, max_model3_inputs);
+            ctx->har = har_;
+            KokoroContext* c = ctx.get();
+            ctx->har_stage = std::make_unique<PipelineStage>([this, c](ChunkJob& job) {
+                return run_har_(*c, job, job.f0.data(), job.har.data());
+            });
+            ctx->post_stage = std::make_unique<PipelineStage>([this, c](ChunkJob& job) {
+                postprocess_chunk_(*c, job);
+                return true;
+            });
+            free_contexts_.push_back(ctx.get());
+        }
 
-        x_.resize(model3_.get_output_size(0) / sizeof(float));
+        return true;
+    }
 
-        duration_shape_ = model1_.get_output_shape(0);
-        d_shape_ = model1_.get_output_shape(1);
+    void uninit(void) {
+        // 其它上下文引用第一个上下文的模型句柄, 倒序卸载
+        for (auto it = contexts_.rbegin(); it != contexts_.rend(); ++it) {
+            for (auto& bucket : (*it)->buckets) {
+                bucket->model1.unload_model();
+                bucket->model2.unload_model();
+                bucket->model3.unload_model();
+            }
+        }
+        free_contexts_.clear();
+        contexts_.clear();
+#ifdef WITH_ONNXRUNTIME
+        model4_.release();
+#endif
+    }
 
-        F0_pred_shape_ = model2_.get_output_shape(0);
+    bool run(const std::string& text, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) {
+        return run_(SynthesisInput(text), run_config, audio);
+    }
 
-        x_shape_ = model3_.get_output_shape(0);
+    bool run_phonemes(const std::string& phonemes, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) {
+        return run_(SynthesisInput(phonemes, SynthesisInput::PHONEMES), run_config, audio);
+    }
 
+    bool run_tokens(const std::vector<int>& tokens, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) {
+        return run_(SynthesisInput(tokens), run_config, audio);
+    }
+
+    bool run_(const SynthesisInput& input, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) {
+        ContextLease ctx(*this);
+        std::vector<float>& audio_data = ctx->workspace.audio;
+        audio_data.clear();
+        bool ok = synthesize_(*ctx, input, run_config, 
+            [&audio_data](std::vector<float>& chunk, bool is_last) {
+                audio_data.insert(audio_data.end(), chunk.begin(), chunk.end());
+                return true;
+            });
+        if (!ok) {
+            return false;
+        }
+
+        *audio = make_audio_(audio_data, run_config);
         return true;
     }
 
-    void uninit(void) {
-        model1_.unload_model();
-        model2_.unload_model();
-        model3_.unload_model();
-        model4_.release();
+    bool run_batch(const std::vector<std::string>& texts, AX_TTS_RUN_CONFIG* run_config, 
+                   const BatchDoneHandler& on_done) {
+        // 按文本长度排序后分组, 长度相近的块拼在一起, padding 少
+        std::vector<size_t> order(texts.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), 
+            [&texts](size_t a, size_t b) { return texts[a].size() < texts[b].size(); });
+
+        // 每组占用一个执行上下文, 一组在 NPU 上推理时, 其它组可以跑前端和后处理
+        size_t num_groups = (texts.size() + BATCH_GROUP_SIZE - 1) / BATCH_GROUP_SIZE;
+        size_t num_workers = std::min(num_groups, contexts_.size());
+        std::atomic<size_t> next_group{0};
+        std::atomic<bool> ok{true};
+        auto worker = [&]() {
+            std::vector<size_t> indices;
+            for (size_t g = next_group++; g < num_groups; g = next_group++) {
+                auto begin = order.begin() + g * BATCH_GROUP_SIZE;
+                indices.assign(begin, begin + std::min<size_t>(BATCH_GROUP_SIZE, order.end() - begin));
+                if (!run_group_(texts, indices, run_config, on_done))
+                    ok = false;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_workers; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads) {
+            t.join();
+        }
+        return ok;
     }
 
-    bool run(const std::string& text, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) {
+    bool run_into(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                  void* buffer, int buffer_len, int* num_samples) {
+        // 每块直接转换进调用者的缓冲, 放不下的部分只计数, 用于返回需要的大小
+        ContextLease ctx(*this);
+        int format = run_config->sample_format;
+        size_t sample_bytes = bytes_per_sample_(format);
+        utils::DitherState dither;
+        size_t total = 0;
+        bool ok = synthesize_(*ctx, SynthesisInput(text), run_config, 
+            [&](std::vector<float>& chunk, bool is_last) {
+                if (total < (size_t)buffer_len) {
+                    size_t count = std::min(chunk.size(), buffer_len - total);
+                    convert_samples_(chunk.data(), count, format, (char*)buffer + total * sample_bytes, dither);
+                }
+                total += chunk.size();
+                return true;
+            });
+
+        *num_samples = (int)total;
+        return ok;
+    }
+
+    bool run_stream(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                    AX_TTS_STREAM_CALLBACK callback, void* user_data) {
+        ContextLease ctx(*this);
+        std::vector<float>& stream_buf = ctx->stream_buf;
+        int format = run_config->sample_format;
+        size_t sample_bytes = bytes_per_sample_(format);
+        utils::DitherState dither;
+        return synthesize_(*ctx, SynthesisInput(text), run_config, 
+            [&](std::vector<float>& chunk, bool is_last) {
+                // AX_TTS_AUDIO 末尾是柔性数组, 用 float 数组做存储并复用
+                size_t header_len = (sizeof(AX_TTS_AUDIO) + sizeof(float) - 1) / sizeof(float);
+                size_t data_len = (chunk.size() * sample_bytes + sizeof(float) - 1) / sizeof(float);
+                stream_buf.resize(header_len + data_len);
+
+                AX_TTS_AUDIO* audio_ptr = reinterpret_cast<AX_TTS_AUDIO*>(stream_buf.data());
+                audio_ptr->channels = 1;
+                audio_ptr->num_samples = chunk.size();
+                audio_ptr->sample_rate = run_config->sample_rate;
+                convert_samples_(chunk.data(), chunk.size(), format, audio_ptr->data, dither);
+
+                return callback(audio_ptr, is_last ? 1 : 0, user_data) == 0;
+            });
+    }
+
+    void get_stats(AX_TTS_STATS* stats, bool reset) {
+        stats_.get(stats);
+        stats->num_g2p_workers = frontend_.num_g2p_workers();
+        frontend_.get_g2p_cache_stats(stats->g2p_cache_hits, stats->g2p_cache_misses, reset);
+        if (reset) {
+            stats_.reset();
+        }
+    }
+
+    bool warmup(const std::vector<std::string>& voices) {
+        if (voices.empty()) {
+            ALOGE("At least one voice is needed for warmup");
+            return false;
+        }
+
+        // 音色读进共享缓存, 之后的请求不再读文件
+        for (const auto& voice : voices) {
+            if (!get_voice_style_(voice_path_, voice)) {
+                ALOGE("Load voice %s failed!", voice.c_str());
+                return false;
+            }
+        }
+
+        // espeak 第一次运行时加载词典
+        int err = 0;
+        std::vector<int> input_ids = frontend_.run(WARMUP_TEXT, vocab_, err);
+        if (err != 0) {
+            ALOGE("Warmup frontend failed!");
+            return false;
+        }
+
+        AX_TTS_RUN_CONFIG run_config;
+        memset(&run_config, 0, sizeof(run_config));
+        run_config.speed = DEFAULT_SPEED;
+        run_config.sample_rate = MODEL_SAMPLE_RATE;
+        snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", voices[0].c_str());
+
+        // 占住所有上下文, 每个上下文的每个模型各跑一次, IO 缓冲和 HAR/ORT 都在这里完成首次运行
+        // 两个预热各占一部分上下文会互相等待, 同一时刻只允许一个预热; 请求只占一个上下文, 用完就释放
+        std::lock_guard<std::mutex> lock(warmup_mutex_);
+        std::deque<ContextLease> leases;
+        for (size_t i = 0; i < contexts_.size(); i++) {
+            leases.emplace_back(*this);
+        }
+        for (auto& ctx : leases) {
+            ctx->warming = true;
+            bool ok = prepare_voice_(*ctx, &run_config) && warmup_context_(*ctx, input_ids, &run_config);
+            ctx->warming = false;
+            if (!ok) {
+                ALOGE("Warmup models failed!");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool start_trace(const std::string& path) {
+        return stats_.trace().start(path);
+    }
+
+    bool stop_trace() {
+        return stats_.trace().stop();
+    }
+
+private:
+    // 在一个执行上下文上合成 texts 中 indices 指定的文本
+    bool run_group_(const std::vector<std::string>& texts, const std::vector<size_t>& indices, 
+                    AX_TTS_RUN_CONFIG* run_config, const BatchDoneHandler& on_done) {
+        ContextLease ctx(*this);
+        std::vector<bool> done(indices.size(), false);
+        auto finish = [&](size_t i, AX_TTS_AUDIO* audio) {
+            done[i] = true;
+            on_done(indices[i], audio);
+        };
+
+        bool ok = prepare_voice_(*ctx, run_config);
+        if (ok) {
+            // 每个请求的音频分别拼接, 最后一块到达时就交给 on_done, 不等其它请求
+            std::vector<std::vector<float>> audio_data(indices.size());
+            std::vector<ChunkHandler> handlers(indices.size());
+            std::vector<SynthesisItem>& items = ctx->workspace.items;
+            items.resize(indices.size());
+            for (size_t i = 0; i < indices.size(); i++) {
+                handlers[i] = [&, i](std::vector<float>& chunk, bool is_last) {
+                    audio_data[i].insert(audio_data[i].end(), chunk.begin(), chunk.end());
+                    if (is_last) {
+                        finish(i, make_audio_(audio_data[i], run_config));
+                        std::vector<float>().swap(audio_data[i]);
+                    }
+                    return true;
+                };
+                if (!prepare_item_(items[i], SynthesisInput(texts[indices[i]]), handlers[i])) {
+                    ALOGE("Run frontend of text %d failed!", (int)indices[i]);
+                }
+            }
+            ok = synthesize_items_(*ctx, items, run_config, true);
+        }
+
+        // 失败的请求也要通知到
+        for (size_t i = 0; i < indices.size(); i++) {
+            if (!done[i])
+                finish(i, nullptr);
+        }
+        return ok;
+    }
+
+    static AX_TTS_AUDIO* make_audio_(const std::vector<float>& samples, AX_TTS_RUN_CONFIG* run_config) {
+        int format = run_config->sample_format;
+        AX_TTS_AUDIO* audio = (AX_TTS_AUDIO*)malloc(sizeof(AX_TTS_AUDIO) + bytes_per_sample_(format) * samples.size());
+        audio->channels = 1;
+        audio->num_samples = samples.size();
+        audio->sample_rate = run_config->sample_rate;
+        utils::DitherState dither;
+        convert_samples_(samples.data(), samples.size(), format, audio->data, dither);
+        return audio;
+    }
+
+    static size_t bytes_per_sample_(int sample_format) {
+        return sample_format == AX_TTS_SAMPLE_FLOAT32 ? sizeof(float) : sizeof(int16_t);
+    }
+
+    // 输出前的最后一次拷贝, 顺便做格式转换, 调用者不需要再遍历一遍
+    static void convert_samples_(const float* samples, size_t len, int sample_format, void* out, utils::DitherState& dither) {
+        switch (sample_format) {
+            case AX_TTS_SAMPLE_INT16:
+                utils::float_to_s16(samples, len, (int16_t*)out);
+                break;
+            case AX_TTS_SAMPLE_INT16_DITHER:
+                utils::float_to_s16_dither(samples, len, (int16_t*)out, dither);
+                break;
+            default:
+                std::memcpy(out, samples, sizeof(float) * len);
+                break;
+        }
+    }
+
+    KokoroContext* acquire_context_() {
+        auto wait_start = TTSStats::Clock::now();
+        KokoroContext* ctx;
+        {
+            std::unique_lock<std::mutex> lock(contexts_mutex_);
+            contexts_cv_.wait(lock, [this]() { return !free_contexts_.empty(); });
+            ctx = free_contexts_.back();
+            free_contexts_.pop_back();
+        }
+        stats_.trace().add("wait_context", wait_start, TTSStats::Clock::now(), TraceTag());
+        return ctx;
+    }
+
+    void release_context_(KokoroContext* ctx) {
+        {
+            std::lock_guard<std::mutex> lock(contexts_mutex_);
+            free_contexts_.push_back(ctx);
+        }
+        contexts_cv_.notify_one();
+    }
+
+    bool prepare_voice_(KokoroContext& ctx, AX_TTS_RUN_CONFIG* run_config) {
         if (!run_config->voice) {
             ALOGE("voice is not set");
             return false;
         }
 
-        std::string voice_name(run_config->voice);
-        if (voice_name != voice_name_) {
+        if (ctx.voice_name != run_config->voice) {
             // Reload voice tensor if voice name is changed
-            if (!get_voice_style_(voice_path_, voice_name)) {
+            std::string voice_name(run_config->voice);
+            auto voice = get_voice_style_(voice_path_, voice_name);
+            if (!voice) {
                 ALOGE("Load voice failed!");
                 return false;
             }
-            voice_name_ = voice_name;
+            ctx.voice = std::move(voice);
+            ctx.voice_name = voice_name;
         }
+        return true;
+    }
 
+    // 前端 -> 按句切分 -> 逐句推理, 每句完成后交给 on_chunk
+    bool synthesize_(KokoroContext& ctx, const SynthesisInput& input, AX_TTS_RUN_CONFIG* run_config, const ChunkHandler& on_chunk) {
+        if (!prepare_voice_(ctx, run_config)) {
+            return false;
+        }
+
+        std::vector<SynthesisItem>& items = ctx.workspace.items;
+        items.resize(1);
+        if (!prepare_item_(items[0], input, on_chunk)) {
+            return false;
+        }
+        return synthesize_items_(ctx, items, run_config);
+    }
+
+    bool prepare_item_(SynthesisItem& item, const SynthesisInput& input, const ChunkHandler& on_chunk) {
+        item.start = TTSStats::Clock::now();
+        item.num_samples = 0;
+        item.request_id = next_request_id_++;
+
+        TraceTag tag;
+        tag.request = item.request_id;
         int err = 0;
-        auto input_ids = frontend_.run(text, vocab_, err);
+        std::vector<int>& input_ids = item.input_ids;
+        switch (input.type) {
+            case SynthesisInput::TEXT:
+                // 前端自己处理 espeak 的互斥, 有 g2p worker 时多个请求可以同时做 G2P
+                input_ids = frontend_.run(*input.str, vocab_, err, &stats_, tag);
+                break;
+            case SynthesisInput::PHONEMES:
+                // 调用者已经做过 G2P, 不经过 espeak
+                input_ids = TTSFrontend::tokenize(*input.str, vocab_, &stats_, tag);
+                break;
+            case SynthesisInput::TOKENS:
+                input_ids.clear();
+                input_ids.push_back(0);
+                for (int id : *input.tokens) {
+                    if (!vocab_ids_.count(id)) {
+                        ALOGE("Token id %d is not in vocab!", id);
+                        err = -1;
+                        break;
+                    }
+                    input_ids.push_back(id);
+                }
+                input_ids.push_back(0);
+                break;
+        }
         if (err != 0) {
+            item.chunks.clear();
+            finish_item_(item, false);
             return false;
         }
-        printf("[");
-        for (auto i : input_ids) {
-            printf("%d ", i);
+        // 调试级别才拼接 token 序列, 避免每个请求都写 stdout
+        if (ax_tts_log_level >= AX_TTS_LOG_DEBUG) {
+            std::string ids;
+            for (auto id : input_ids) {
+                ids += std::to_string(id) + " ";
+            }
+            ALOGD("input_ids: [%s]", ids.c_str());
+        }
+
+        split_chunks_(input_ids, item);
+        item.on_chunk = &on_chunk;
+        item.tail.clear();
+        item.next_chunk = 0;
+        item.parked.clear();
+        item.stopped = false;
+        return true;
+    }
+
+    // 逐个 pass 推理, 一个 pass 可以拼接多个请求的短块, 音频按块切回各请求
+    // by_length 时不再按块的先后规划, 只适合不需要边合成边输出的场景
+    bool synthesize_items_(KokoroContext& ctx, std::vector<SynthesisItem>& items, AX_TTS_RUN_CONFIG* run_config, 
+                           bool by_length = false) {
+        KokoroWorkspace& workspace = ctx.workspace;
+        std::vector<PackSegment>& plan = workspace.plan;
+        std::vector<size_t>& pass_begin = workspace.pass_begin;
+        plan_passes_(items, plan, pass_begin, by_length, run_config->pack_texts != 0);
+        size_t num_passes = pass_begin.size() - 1;
+
+        // 每块末尾保留一小段, 与同一请求下一块开头交叉淡化后再输出
+        int crossfade_samples = int(run_config->sample_rate * CROSSFADE_DURATION);
+
+        // 流水线, 三个 job 轮流使用:
+        // NPU 跑第 i 个 pass 的 model1/model2 时, 第 i-1 个在另一线程算 HAR;
+        // 接着 NPU 跑第 i-1 个的 model3, 同时第 i 个算 HAR, 第 i-2 个做 iSTFT 等后处理
+        // 只有一个 pass 时没有可以重叠的工作, 按顺序跑完, 也不用保存共享的缓冲
+        bool pipelined = num_passes > 1;
+        ChunkJob* har_job = nullptr;    // 在算 HAR, 还没跑 model3
+        ChunkJob* post_job = nullptr;   // 在做后处理, 还没交付
+        bool ok = true;
+        bool stopped = false;
+
+        // 返回 false 表示所有请求都不再需要输出
+        auto deliver = [&](ChunkJob& job) {
+            auto deliver_start = TTSStats::Clock::now();
+            // 倒序交付: 偏移为 0 的第一段最后处理, 直接在 job.audio 上裁剪, 不用拷贝
+            for (int k = (int)job.segments.size() - 1; k >= 0; k--) {
+                const PackSegment& seg = job.segments[k];
+                if (seg.item < 0 || items[seg.item].stopped)
+                    continue;
+
+                SynthesisItem& item = items[seg.item];
+                auto begin = job.audio.begin() + seg.begin_sample;
+                auto end = job.audio.begin() + seg.end_sample;
+                if (seg.chunk != item.next_chunk) {
+                    // 前面的块还没推理, 先存起来
+                    item.parked[seg.chunk].assign(begin, end);
+                    continue;
+                }
+
+                std::vector<float>* audio = &job.audio;
+                if (seg.begin_sample == 0) {
+                    job.audio.resize(seg.end_sample);
+                } else {
+                    item.slice.assign(begin, end);
+                    audio = &item.slice;
+                }
+                deliver_chunk_(item, *audio, crossfade_samples);
+
+                // 接着交付已经完成的后续块
+                for (auto it = item.parked.find(item.next_chunk); !item.stopped && it != item.parked.end(); 
+                     it = item.parked.find(item.next_chunk)) {
+                    deliver_chunk_(item, it->second, crossfade_samples);
+                    item.parked.erase(it);
+                }
+            }
+            TraceTag tag;
+            tag.pass = job.pass_id;
+            stats_.trace().add("deliver", deliver_start, TTSStats::Clock::now(), tag);
+            return std::any_of(items.begin(), items.end(), 
+                [](const SynthesisItem& item) { return !item.stopped && !item.chunks.empty(); });
+        };
+
+        for (size_t i = 0; i < num_passes; i++) {
+            ChunkJob* job = &workspace.jobs[i % 3];
+            auto pass_start = TTSStats::Clock::now();
+            const PackSegment* segments = plan.data() + pass_begin[i];
+            size_t num_segments = pass_begin[i + 1] - pass_begin[i];
+            if (!run_front_(ctx, items, segments, num_segments, run_config, *job)) {
+                ALOGE("Run models failed!");
+                ok = false;
+                break;
+            }
+            trace_pass_(items, *job, pass_start);
+
+            if (!pipelined) {
+                ok = run_back_(ctx, *job);
+                if (ok) {
+                    postprocess_chunk_(ctx, *job);
+                    deliver(*job);
+                }
+                break;
+            }
+
+            // 下一个 pass 的 model1/model2 会覆盖共享的缓冲, 先存下来
+            save_model3_inputs_(*job);
+
+            // 两个 HAR 共用 ctx.har, 上一个完成后才开始这一个
+            ChunkJob* prev = har_job;
+            bool prev_har_ok = !prev || ctx.har_stage->wait();
+            har_job = job;
+            ctx.har_stage->submit(job);
+            if (!prev)
+                continue;
+
+            if (!prev_har_ok || !run_model3_(ctx, *prev, true)) {
+                ok = false;
+                break;
+            }
+
+            if (post_job) {
+                ctx.post_stage->wait();
+                stopped = !deliver(*post_job);
+                if (stopped)
+                    break;
+            }
+            post_job = prev;
+            ctx.post_stage->submit(prev);
         }
-        printf("]\n");
 
-        // get voice
-        auto ref_s = load_voice_embedding_(input_ids.size());
+        // 排空流水线: 最后一个 pass 的 model3 与倒数第二个的后处理重叠
+        if (har_job) {
+            bool har_ok = ctx.har_stage->wait();
+            if (ok && !stopped) {
+                ok = har_ok && run_model3_(ctx, *har_job, true);
+            }
+        }
+        if (post_job) {
+            ctx.post_stage->wait();
+            if (ok && !stopped) {
+                stopped = !deliver(*post_job);
+            }
+        }
+        if (ok && !stopped && har_job) {
+            postprocess_chunk_(ctx, *har_job);
+            deliver(*har_job);
+        }
 
-        std::vector<float> audio_data;
-        if (!run_models_(input_ids, ref_s, run_config->speed, run_config->fade_out, run_config->sample_rate, audio_data)) {
-            ALOGE("Run models failed!");
+        if (!ok) {
+            finish_items_(items, false);
             return false;
         }
 
-        *audio = (AX_TTS_AUDIO*)malloc(sizeof(AX_TTS_AUDIO) + sizeof(float) * audio_data.size());
-        AX_TTS_AUDIO* audio_ptr = *audio;
-        audio_ptr->channels = 1;
-        audio_ptr->num_samples = audio_data.size();
-        audio_ptr->sample_rate = run_config->sample_rate;
-        std::memcpy(audio_ptr->data, audio_data.data(), sizeof(float) * audio_data.size());
+        // 只剩没有任何块的请求
+        finish_items_(items, true);
+        return true;
+    }
 
+    // 用前端的输出拼出刚好填满各模型的输入, 逐个模型推理并做后处理, 输出丢弃
+    bool warmup_context_(KokoroContext& ctx, const std::vector<int>& input_ids, AX_TTS_RUN_CONFIG* run_config) {
+        std::vector<int> content(input_ids.begin() + 1, input_ids.end() - 1);
+        if (content.empty()) {
+            content.push_back(space_id_ >= 0 ? space_id_ : 0);
+        }
+
+        std::vector<SynthesisItem>& items = ctx.workspace.items;
+        items.resize(1);
+        SynthesisItem& item = items[0];
+        item.tokens.clear();
+        item.chunks.clear();
+        for (auto& bucket : ctx.buckets) {
+            size_t offset = item.tokens.size();
+            item.tokens.resize(offset + bucket->seq_len, 0);
+            for (int i = 1; i < bucket->seq_len - 1; i++) {
+                item.tokens[offset + i] = content[(i - 1) % content.size()];
+            }
+            item.chunks.push_back(ChunkSpan{offset, bucket->seq_len});
+        }
+
+        // 不经过 plan_passes_, 否则短模型的块会被拼进长模型
+        ChunkJob& job = ctx.workspace.jobs[0];
+        for (size_t k = 0; k < item.chunks.size(); k++) {
+            PackSegment seg{};
+            seg.item = 0;
+            seg.chunk = k;
+            seg.is_last = true;
+            seg.len = item.chunks[k].len;
+            if (!run_models_(ctx, items, &seg, 1, run_config, job)) {
+                return false;
+            }
+            postprocess_chunk_(ctx, job);
+        }
+        item.chunks.clear();
         return true;
     }
 
-private:
+    // 一次推理的追踪事件, 列出拼接在其中的各请求的块
+    void trace_pass_(const std::vector<SynthesisItem>& items, const ChunkJob& job, TTSStats::Clock::time_point start) {
+        if (!stats_.trace().enabled())
+            return;
+
+        TraceTag tag;
+        tag.pass = job.pass_id;
+        std::vector<TraceTag> parts;
+        for (const auto& seg : job.segments) {
+            if (seg.item < 0)
+                continue;
+            TraceTag part;
+            part.request = items[seg.item].request_id;
+            part.chunk = seg.chunk;
+            parts.push_back(part);
+        }
+        stats_.trace().add("inference", start, TTSStats::Clock::now(), tag, parts);
+    }
+
+    // 交付 item 的第 next_chunk 块
+    void deliver_chunk_(SynthesisItem& item, std::vector<float>& audio, int crossfade_samples) {
+        bool is_last = (item.next_chunk == item.chunks.size() - 1);
+        apply_crossfade_(item.tail, audio);
+        if (!is_last && crossfade_samples > 0 && audio.size() > crossfade_samples) {
+            item.tail.assign(audio.end() - crossfade_samples, audio.end());
+            audio.resize(audio.size() - crossfade_samples);
+        } else {
+            item.tail.clear();
+        }
+
+        item.next_chunk++;
+        item.num_samples += audio.size();
+        bool more = (*item.on_chunk)(audio, is_last);
+        if (!more) {
+            ALOGD("Synthesis stopped by caller");
+        }
+        if (is_last || !more) {
+            finish_item_(item, true);
+        }
+    }
+
+    // 请求结束, 记录耗时和音频时长
+    void finish_item_(SynthesisItem& item, bool ok) {
+        item.stopped = true;
+        TraceTag tag;
+        tag.request = item.request_id;
+        stats_.add_request(ok, item.start, item.num_samples, MODEL_SAMPLE_RATE, tag);
+    }
+
+    void finish_items_(std::vector<SynthesisItem>& items, bool ok) {
+        for (auto& item : items) {
+            if (!item.stopped)
+                finish_item_(item, ok);
+        }
+    }
+
+    // 默认第 j 轮取每个请求的第 j 块, 同一请求的块按顺序出现在先后的 pass 中
+    // by_length 时所有块按长度从短到长排列, 长度相近的拼在一起, 短请求先完成
+    // 短块拼进同一个 pass, 总长不超过最长的模型, 用拼接代替 padding
+    // 只会往最后一个 pass 中拼接, 所以每个 pass 是 plan 中连续的一段
+    // 一个 pass 只有一个 ref_s (按最长的块选), 拼接后的音频与单独合成不同, 所以只在 pack 时拼接
+    void plan_passes_(const std::vector<SynthesisItem>& items, std::vector<PackSegment>& plan, 
+                      std::vector<size_t>& pass_begin, bool by_length, bool pack) {
+        size_t max_chunks = 0;
+        for (const auto& item : items) {
+            max_chunks = std::max(max_chunks, item.chunks.size());
+        }
+
+        plan.clear();
+        for (size_t j = 0; j < max_chunks; j++) {
+            for (size_t i = 0; i < items.size(); i++) {
+                const auto& chunks = items[i].chunks;
+                if (j >= chunks.size())
+                    continue;
+
+                PackSegment seg{};
+                seg.item = i;
+                seg.chunk = j;
+                seg.is_last = (j == chunks.size() - 1);
+                seg.len = chunks[j].len;
+                plan.push_back(seg);
+            }
+        }
+
+        if (by_length) {
+            std::stable_sort(plan.begin(), plan.end(), 
+                [](const PackSegment& a, const PackSegment& b) { return a.len < b.len; });
+        }
+
+        pass_begin.clear();
+        bool open = false;  // 最后一个 pass 还能继续拼接
+        int open_len = 0;
+        int round = -1;
+        for (size_t k = 0; k < plan.size(); k++) {
+            const PackSegment& seg = plan[k];
+            // 按轮规划时每轮重新开始, 同一请求的两块不会进同一个 pass
+            if (!by_length && seg.chunk != round) {
+                round = seg.chunk;
+                open = false;
+            }
+
+            bool is_short = pack && seg.len * DOUBLE_INPUT_RATIO <= max_seq_len_;
+            if (open && is_short && open_len + seg.len <= max_seq_len_ && k - pass_begin.back() < PACK_MAX_ITEMS) {
+                open_len += seg.len;
+            } else {
+                pass_begin.push_back(k);
+                open = is_short;
+                open_len = seg.len;
+            }
+        }
+        pass_begin.push_back(plan.size());
+    }
+
+    void apply_crossfade_(const std::vector<float>& tail, std::vector<float>& audio) {
+        // 上一块的尾部淡出, 当前块的开头淡入
+        size_t n = std::min(tail.size(), audio.size());
+        for (size_t i = 0; i < n; i++) {
+            float w = (i + 1) * 1.0f / (n + 1);
+            audio[i] = tail[i] * (1.0f - w) + audio[i] * w;
+        }
+    }
+
+    // 先按句切分, 超过模型长度的句子再按标点/空格切成若干窗口
+    // input_ids 形如 [0, ..., 0], 在句末标点之后切开, 每块重新补上首尾的 0
+    void split_chunks_(const std::vector<int>& input_ids, SynthesisItem& item) {
+        item.tokens.clear();
+        item.chunks.clear();
+
+        size_t begin = 1;
+        size_t end = input_ids.size() > 1 ? input_ids.size() - 1 : 1;
+        size_t start = begin;   // 当前句的起点
+        for (size_t i = begin; i < end; i++) {
+            int id = input_ids[i];
+            // 去掉句首空格
+            if (i == start && id == space_id_) {
+                start++;
+                continue;
+            }
+
+            // 连续的句末标点归到同一句
+            bool next_is_mark = (i + 1 < end) && sentence_end_ids_.count(input_ids[i + 1]);
+            if (sentence_end_ids_.count(id) && !next_is_mark) {
+                add_sentence_(input_ids, start, i + 1, item);
+                start = i + 1;
+            }
+        }
+
+        if (start < end || item.chunks.empty()) {
+            add_sentence_(input_ids, start, std::max(start, end), item);
+        }
+    }
+
+    void add_sentence_(const std::vector<int>& input_ids, size_t begin, size_t end, SynthesisItem& item) {
+        if (end - begin + 2 <= max_seq_len_) {
+            add_chunk_(input_ids, begin, end, item);
+        } else {
+            split_long_sentence_(input_ids, begin, end, item);
+        }
+    }
+
+    void add_chunk_(const std::vector<int>& input_ids, size_t begin, size_t end, SynthesisItem& item) {
+        size_t offset = item.tokens.size();
+        item.tokens.push_back(0);
+        item.tokens.insert(item.tokens.end(), input_ids.begin() + begin, input_ids.begin() + end);
+        item.tokens.push_back(0);
+        item.chunks.push_back(ChunkSpan{offset, int(end - begin + 2)});
+    }
+
+    void split_long_sentence_(const std::vector<int>& sentence, size_t sentence_begin, size_t sentence_end, 
+                              SynthesisItem& item) {
+        // 每个窗口的内容最多 max_seq_len_ - 2 个 token
+        int max_content = max_seq_len_ - 2;
+        int begin = sentence_begin;
+        int end = sentence_end;
+
+        while (begin < end) {
+            int len = end - begin;
+            int cut = begin + len;
+            if (len > max_content) {
+                // 优先在标点之后切, 其次在空格处切, 都没有就硬切
+                int last_mark = -1, last_space = -1;
+                for (int i = begin; i < begin + max_content; i++) {
+                    if (clause_mark_ids_.count(sentence[i]))
+                        last_mark = i + 1;
+                    else if (sentence[i] == space_id_)
+                        last_space = i;
+                }
+
+                if (last_mark > begin)
+                    cut = last_mark;
+                else if (last_space > begin)
+                    cut = last_space;
+                else
+                    cut = begin + max_content;
+            }
+
+            add_chunk_(sentence, begin, cut, item);
+
+            // 跳过窗口之间的空格
+            begin = cut;
+            while (begin < end && sentence[begin] == space_id_)
+                begin++;
+        }
+    }
+
     bool load_vocab_(const std::string& vocab_path) {
         if (!utils::file_exist(vocab_path)) {
             ALOGE("vocab path(%s) not exist!", vocab_path.c_str());
@@ -227,6 +1192,7 @@ private:
                     while((pos = token.find("\\t", pos)) != std::string::npos) { token.replace(pos, 2, "\t"); pos += 1; }
                     
                     vocab_[token] = std::stoi(id_str);
+                    vocab_ids_.insert(vocab_[token]);
                 }
             }
         } else {
@@ -234,37 +1200,71 @@ private:
             return false;
         }
 
+        for (const auto& mark : utils::split_utf8(SENTENCE_END_MARKS)) {
+            if (vocab_.count(mark)) {
+                sentence_end_ids_.insert(vocab_.at(mark));
+            }
+        }
+        for (const auto& mark : utils::split_utf8(utils::Punctuator::default_marks())) {
+            if (vocab_.count(mark)) {
+                clause_mark_ids_.insert(vocab_.at(mark));
+            }
+        }
+        space_id_ = vocab_.count(" ") ? vocab_.at(" ") : -1;
+
         return true;
     }
 
-    bool load_models_(const std::string& model_path) {
-        std::string model1_path = model_path + "/kokoro_part1_96.axmodel";
-        std::string model2_path = model_path + "/kokoro_part2_96.axmodel";
-        std::string model3_path = model_path + "/kokoro_part3_96.axmodel";
-        std::string model4_path = model_path + "/model4_har_sim.onnx";
+    bool load_models_(const std::string& model_path, int max_seq_len, 
+                      std::vector<std::unique_ptr<KokoroBucket>>& buckets) {
+        // 加载所有不超过 max_seq_len 的模型组, 按序列长度从小到大排列
+        for (int seq_len : SEQ_LEN_BUCKETS) {
+            if (seq_len > max_seq_len)
+                break;
+
+            std::string model1_path = model_path + "/kokoro_part1_" + std::to_string(seq_len) + ".axmodel";
+            if (!utils::file_exist(model1_path)) {
+                ALOGD("No models for seq_len %d, skip", seq_len);
+                continue;
+            }
 
-        int ret = 0;
-        ret = model1_.load_model(model1_path.c_str());
-        if (ret != 0) {
-            ALOGE("Load model1 from %s failed! ret=0x%x", model1_path.c_str(), ret);
-            return false;
+            auto bucket = load_bucket_(model_path, seq_len);
+            if (!bucket) {
+                return false;
+            }
+            buckets.emplace_back(std::move(bucket));
         }
 
-        ret = model2_.load_model(model2_path.c_str());
-        if (ret != 0) {
-            ALOGE("Load model2 from %s failed! ret=0x%x", model2_path.c_str(), ret);
+        if (buckets.empty()) {
+            ALOGE("No kokoro_part*_<seq_len>.axmodel found in %s with seq_len <= %d", model_path.c_str(), max_seq_len);
             return false;
         }
 
-        ret = model3_.load_model(model3_path.c_str());
-        if (ret != 0) {
-            ALOGE("Load model3 from %s failed! ret=0x%x", model3_path.c_str(), ret);
+        return load_har_(model_path, *buckets.front());
+    }
+
+    bool load_har_(const std::string& model_path, const KokoroBucket& bucket) {
+        std::string har_weights_path = model_path + "/har_weights.bin";
+        bool has_weights = utils::file_exist(har_weights_path);
+
+#ifdef WITH_ONNXRUNTIME
+        // 默认用原生实现. onnx 模型也在时先对比一次 (与 tests/test_har 相同), 超出容差才改用 onnxruntime
+        std::string model4_path = model_path + "/model4_har_sim.onnx";
+        bool has_model4 = utils::file_exist(model4_path);
+        if (!has_weights && !has_model4) {
+            ALOGE("Neither %s nor %s exist", har_weights_path.c_str(), model4_path.c_str());
             return false;
         }
 
-        if (!utils::file_exist(model4_path)) {
-            ALOGE("model4 %s not exist", model4_path.c_str());
-            return false;
+        if (has_weights && !har_.load(har_weights_path)) {
+            if (!has_model4) {
+                return false;
+            }
+            ALOGW("Load %s failed, use onnxruntime for HAR", har_weights_path.c_str());
+        }
+        if (!has_model4) {
+            ALOGI("HAR: native, %s", har_weights_path.c_str());
+            return true;
         }
 
         env_ = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "Kokoro");
@@ -275,318 +1275,503 @@ private:
 
         model4_ = Ort::Session(env_, model4_path.c_str(), session_options);
 
-        // Prepare model outputs
-        duration_.resize(model1_.get_output_size(0) / sizeof(float));
-        d_.resize(model1_.get_output_size(1) / sizeof(float));
+        if (har_.loaded() && !check_native_har_(bucket)) {
+            // 未加载权重的 KokoroHar 让 compute_har_ 走 onnxruntime
+            har_ = KokoroHar(MODEL_SAMPLE_RATE, N_FFT, HOP_LENGTH);
+        }
+        ALOGI("HAR: %s", har_.loaded() ? "native" : "onnxruntime");
+        return true;
+#else
+        if (!has_weights) {
+            ALOGE("%s not exist, export it with scripts/export_har_weights.py", har_weights_path.c_str());
+            return false;
+        }
+        return har_.load(har_weights_path);
+#endif
+    }
 
-        // F0_pred, N_pred, asr = outputs2
-        F0_pred_.resize(model2_.get_output_size(0) / sizeof(float));
-        N_pred_.resize(model2_.get_output_size(1) / sizeof(float));
-        asr_.resize(model2_.get_output_size(2) / sizeof(float));
+    std::unique_ptr<KokoroBucket> load_bucket_(const std::string& model_path, int seq_len) {
+        std::string suffix = "_" + std::to_string(seq_len) + ".axmodel";
+        std::string model1_path = model_path + "/kokoro_part1" + suffix;
+        std::string model2_path = model_path + "/kokoro_part2" + suffix;
+        std::string model3_path = model_path + "/kokoro_part3" + suffix;
+
+        auto bucket = std::make_unique<KokoroBucket>();
+        bucket->seq_len = seq_len;
+
+        int ret = 0;
+        ret = bucket->model1.load_model(model1_path.c_str());
+        if (ret != 0) {
+            ALOGE("Load model1 from %s failed! ret=0x%x", model1_path.c_str(), ret);
+            return nullptr;
+        }
+
+        ret = bucket->model2.load_model(model2_path.c_str());
+        if (ret != 0) {
+            ALOGE("Load model2 from %s failed! ret=0x%x", model2_path.c_str(), ret);
+            return nullptr;
+        }
+
+        ret = bucket->model3.load_model(model3_path.c_str());
+        if (ret != 0) {
+            ALOGE("Load model3 from %s failed! ret=0x%x", model3_path.c_str(), ret);
+            return nullptr;
+        }
 
-        x_.resize(model3_.get_output_size(0) / sizeof(float));
+        bucket->x_size = bucket->model3.get_output_size(0) / sizeof(float);
 
-        duration_shape_ = model1_.get_output_shape(0);
-        d_shape_ = model1_.get_output_shape(1);
+        bucket->duration_shape = bucket->model1.get_output_shape(0);
+        bucket->d_shape = bucket->model1.get_output_shape(1);
 
-        F0_pred_shape_ = model2_.get_output_shape(0);
+        bucket->aln_shape = bucket->model2.get_input_shape(4);
+        bucket->F0_pred_shape = bucket->model2.get_output_shape(0);
 
-        x_shape_ = model3_.get_output_shape(0);
-        return true;
+        bucket->har_shape = bucket->model3.get_input_shape(4);
+        bucket->x_shape = bucket->model3.get_output_shape(0);
+
+        link_bucket_(*bucket);
+        return bucket;
     }
 
-    bool get_voice_style_(const std::string& voices_path, const std::string& voice_name) {
+    std::unique_ptr<KokoroContext> clone_context_(KokoroContext& owner) {
+        auto ctx = std::make_unique<KokoroContext>();
+        for (auto& src : owner.buckets) {
+            auto bucket = std::make_unique<KokoroBucket>();
+            bucket->seq_len = src->seq_len;
+            if (bucket->model1.attach_model(src->model1) != 0 ||
+                bucket->model2.attach_model(src->model2) != 0 ||
+                bucket->model3.attach_model(src->model3) != 0) {
+                ALOGE("Attach models of bucket %d failed!", src->seq_len);
+                // 已经 attach 的模型不销毁句柄, 只释放自己的 IO
+                bucket->model1.unload_model();
+                bucket->model2.unload_model();
+                bucket->model3.unload_model();
+                for (auto& b : ctx->buckets) {
+                    b->model1.unload_model();
+                    b->model2.unload_model();
+                    b->model3.unload_model();
+                }
+                return nullptr;
+            }
+
+            bucket->x_size = src->x_size;
+            bucket->duration_shape = src->duration_shape;
+            bucket->d_shape = src->d_shape;
+            bucket->aln_shape = src->aln_shape;
+            bucket->F0_pred_shape = src->F0_pred_shape;
+            bucket->har_shape = src->har_shape;
+            bucket->x_shape = src->x_shape;
+
+            link_bucket_(*bucket);
+            ctx->buckets.emplace_back(std::move(bucket));
+        }
+        return ctx;
+    }
+
+    void link_bucket_(KokoroBucket& b) {
+        // 模型之间直接共享 CMM 缓冲, 省去主机侧的拷贝
+        // model1: input_ids, ref_s, text_mask
+        // model2: en, ref_s, input_ids, text_mask(float), pred_aln_trg -> F0_pred, N_pred, asr
+        // model3: asr, F0_pred, N_pred, ref_s, har
+        link_tensor_(b, &b.model1, 1, false, &b.model2, 1);
+        link_tensor_(b, &b.model1, 0, false, &b.model2, 2);
+        link_tensor_(b, &b.model2, 2, true, &b.model3, 0);
+        link_tensor_(b, &b.model2, 0, true, &b.model3, 1);
+        link_tensor_(b, &b.model2, 1, true, &b.model3, 2);
+        link_tensor_(b, &b.model1, 1, false, &b.model3, 3);
+    }
+
+    KokoroBucket& select_bucket_(KokoroContext& ctx, int actual_len) {
+        // 选能放下输入的最短模型
+        for (auto& bucket : ctx.buckets) {
+            if (bucket->seq_len >= actual_len)
+                return *bucket;
+        }
+        return *ctx.buckets.back();
+    }
+
+    std::shared_ptr<const std::vector<float>> get_voice_style_(const std::string& voices_path, const std::string& voice_name) {
+        // 音色只读, 所有上下文共用一份, 加载过的不再读文件
+        std::lock_guard<std::mutex> lock(voices_mutex_);
+        auto it = voices_.find(voice_name);
+        if (it != voices_.end()) {
+            return it->second;
+        }
+
         // 打开文件（二进制模式）
         std::string voice_bin_path = voices_path + "/" + voice_name + ".bin";
         if (!utils::file_exist(voice_bin_path)) {
             ALOGE("voice path %s not exist", voice_bin_path.c_str());
-            return false;
+            return nullptr;
         }
 
-        voice_tensor_.resize(MAX_PHONEME_LENGTH * STYLE_DIM);
+        auto voice_tensor = std::make_shared<std::vector<float>>(MAX_PHONEME_LENGTH * STYLE_DIM);
         std::vector<char> raw_data;
         if (!utils::read_file(voice_bin_path, raw_data)) {
             ALOGE("Read file %s failed!", voice_bin_path.c_str());
-            return false;
+            return nullptr;
         }
 
-        if (raw_data.size() / 4 != voice_tensor_.size()) {
+        if (raw_data.size() / 4 != voice_tensor->size()) {
             ALOGE("File size not equal to %d*%d", MAX_PHONEME_LENGTH, STYLE_DIM);
-            return false;
+            return nullptr;
         }
         
-        std::memcpy(voice_tensor_.data(), raw_data.data(), raw_data.size());
-        return true;
+        std::memcpy(voice_tensor->data(), raw_data.data(), raw_data.size());
+        voices_[voice_name] = voice_tensor;
+        return voice_tensor;
     }
 
-    std::vector<float> load_voice_embedding_(int phoneme_len) {
+    void load_voice_embedding_(KokoroContext& ctx, int phoneme_len, std::vector<float>& ref_s) {
+        const std::vector<float>& voice_tensor = *ctx.voice;
         phoneme_len = std::max(phoneme_len, 0);
-        std::vector<float> ref_s(STYLE_DIM);
-        if (phoneme_len < MAX_PHONEME_LENGTH) {
-            ref_s.assign(voice_tensor_.begin() + phoneme_len * STYLE_DIM, voice_tensor_.begin() + (phoneme_len + 1) * STYLE_DIM);
-        } else {
-            int idx = MAX_PHONEME_LENGTH / 2;
-            ref_s.assign(voice_tensor_.begin() + idx * STYLE_DIM, voice_tensor_.begin() + (idx + 1) * STYLE_DIM);
-        }
-        return ref_s;
+        int idx = phoneme_len < MAX_PHONEME_LENGTH ? phoneme_len : MAX_PHONEME_LENGTH / 2;
+        ref_s.assign(voice_tensor.begin() + idx * STYLE_DIM, voice_tensor.begin() + (idx + 1) * STYLE_DIM);
     }
 
+    // 一个 pass 的全部模型, 按顺序运行
     bool run_models_(
-        std::vector<int>& input_ids,
-        const std::vector<float>& ref_s,
-        float speed,
-        float fade_out,
-        int sample_rate,
-        std::vector<float>& audio
+        KokoroContext& ctx,
+        const std::vector<SynthesisItem>& items,
+        const PackSegment* segments,
+        size_t num_segments,
+        AX_TTS_RUN_CONFIG* run_config,
+        ChunkJob& job
     ) {
+        return run_front_(ctx, items, segments, num_segments, run_config, job) && run_back_(ctx, job);
+    }
+
+    // 拼接输入, 运行 model1 和 model2
+    bool run_front_(
+        KokoroContext& ctx,
+        const std::vector<SynthesisItem>& items,
+        const PackSegment* segments,
+        size_t num_segments,
+        AX_TTS_RUN_CONFIG* run_config,
+        ChunkJob& job
+    ) {
+        // 各块首尾都是 0, 直接拼接: [0 a 0 0 b 0 ...], 相邻的 0 作为分隔
+        std::vector<int>& input_ids = ctx.workspace.input_ids;
+        input_ids.clear();
+        job.pass_id = next_pass_id_++;
+        job.segments.assign(segments, segments + num_segments);
+        int max_len = 0;
+        for (auto& seg : job.segments) {
+            const SynthesisItem& item = items[seg.item];
+            auto chunk = item.tokens.begin() + item.chunks[seg.chunk].offset;
+            seg.offset = input_ids.size();
+            seg.len = item.chunks[seg.chunk].len;
+            input_ids.insert(input_ids.end(), chunk, chunk + seg.len);
+            max_len = std::max(max_len, seg.len);
+        }
+
         int actual_len = input_ids.size();
-        // 填充到固定长度
-        int padding_len = max_seq_len_ - actual_len;
-        if (padding_len > 0) {
-            std::vector<int> padding(padding_len, 0);
-            input_ids.insert(input_ids.end(), padding.begin(), padding.end());
+        if (actual_len > max_seq_len_) {
+            ALOGE("input length %d exceed max_seq_len %d", actual_len, max_seq_len_);
+            return false;
         }
 
-        int fade_samples = 0;
-        if (fade_out > 0) {
-            fade_samples = int(sample_rate * fade_out);
+        KokoroBucket& bucket = select_bucket_(ctx, actual_len);
+        job.bucket = &bucket;
+        job.seq_len = bucket.seq_len;
+        job.num_frames = bucket.x_shape[2];
+
+        // 只有一个很短的块时复制一遍, 适配短文本, 复制部分的输出丢弃
+        if (job.segments.size() == 1 && actual_len * DOUBLE_INPUT_RATIO <= bucket.seq_len) {
+            PackSegment copy = job.segments[0];
+            copy.item = -1;
+            copy.is_last = false;
+            copy.offset = actual_len;
+            job.segments.push_back(copy);
+
+            input_ids.resize(actual_len * 2);
+            std::copy(input_ids.begin(), input_ids.begin() + actual_len, input_ids.begin() + actual_len);
+            actual_len *= 2;
         }
 
-        int actual_content_frames;
-        int total_frames;
-        if (!inference_single_chunk_(input_ids, 
-            ref_s, actual_len, speed, audio, actual_content_frames, total_frames)) {
-            return false;
+        // 填充到模型的固定长度
+        input_ids.resize(bucket.seq_len, 0);
+
+        job.fade_samples = 0;
+        if (run_config->fade_out > 0) {
+            job.fade_samples = int(run_config->sample_rate * run_config->fade_out);
         }
 
-        trim_audio_by_content_(
-            audio, actual_content_frames, total_frames, actual_len
-        );
+        // 音色按最长一块的长度选取, 只有一块时与单独推理一致
+        std::vector<float>& ref_s = ctx.workspace.ref_s;
+        load_voice_embedding_(ctx, max_len, ref_s);
 
-        if (fade_samples > 0)
-            apply_fade_out_(audio, fade_samples);
+        job.actual_len = actual_len;
+        return infer_front_(ctx, bucket, input_ids, ref_s, actual_len, run_config->speed, job);
+    }
 
-        return true;
+    // 不经过流水线: HAR 直接读 model2 的 F0_pred, 结果写进 model3 的输入
+    bool run_back_(KokoroContext& ctx, ChunkJob& job) {
+        KokoroBucket& bucket = *job.bucket;
+        return run_har_(ctx, job, bucket.model2.get_output_data<float>(0), 
+                        bucket.model3.get_input_data<float>(MODEL3_HAR_INPUT)) &&
+               run_model3_(ctx, job, false);
+    }
+
+    // 预热的上下文不计入统计, 不能用 reset 清掉, 那样会连同并发请求的样本一起清掉
+    TTSStats* stats_of_(const KokoroContext& ctx) {
+        return ctx.warming ? nullptr : &stats_;
+    }
+
+    bool run_har_(KokoroContext& ctx, ChunkJob& job, float* F0_pred, float* har) {
+        TraceTag tag;
+        tag.pass = job.pass_id;
+        ScopedStageTimer timer(stats_of_(ctx), AX_TTS_STAGE_HAR, tag);
+        return compute_har_(ctx, F0_pred, job.bucket->F0_pred_shape, har, job.bucket->har_shape);
+    }
+
+    // 存下 model3 与 model1/model2 共享的输入和 HAR 要读的 F0_pred
+    void save_model3_inputs_(ChunkJob& job) {
+        KokoroBucket& bucket = *job.bucket;
+        AxModelRunner& model3 = bucket.model3;
+        // 不能共享缓冲时先拷到 model3 的输入, 再一起保存
+        sync_links_(bucket, &model3);
+
+        size_t total = 0;
+        for (int k = 0; k < MODEL3_SHARED_INPUTS; k++) {
+            total += model3.get_input_size(k);
+        }
+        job.model3_inputs.resize(total);
+        uint8_t* dst = job.model3_inputs.data();
+        for (int k = 0; k < MODEL3_SHARED_INPUTS; k++) {
+            std::memcpy(dst, model3.get_input_ptr(k), model3.get_input_size(k));
+            dst += model3.get_input_size(k);
+        }
+
+        const float* f0 = bucket.model2.get_output_data<float>(0);
+        job.f0.assign(f0, f0 + bucket.model2.get_output_size(0) / sizeof(float));
+        job.har.resize(model3.get_input_size(MODEL3_HAR_INPUT) / sizeof(float));
+    }
+
+    void restore_model3_inputs_(ChunkJob& job) {
+        AxModelRunner& model3 = job.bucket->model3;
+        const uint8_t* src = job.model3_inputs.data();
+        for (int k = 0; k < MODEL3_SHARED_INPUTS; k++) {
+            std::memcpy(model3.get_input_ptr(k), src, model3.get_input_size(k));
+            src += model3.get_input_size(k);
+        }
+        std::memcpy(model3.get_input_ptr(MODEL3_HAR_INPUT), job.har.data(), model3.get_input_size(MODEL3_HAR_INPUT));
+    }
+
+    // CPU 后处理: 频谱转音频, 按块切分, 淡出. 只读 job, 可以在其它线程执行
+    void postprocess_chunk_(KokoroContext& ctx, ChunkJob& job) {
+        TraceTag tag;
+        tag.pass = job.pass_id;
+
+        // 转换为音频
+        {
+            ScopedStageTimer timer(stats_of_(ctx), AX_TTS_STAGE_ISTFT, tag);
+            postprocess_x_to_audio_(ctx, job.x, job.num_frames, job.audio);
+        }
+
+        // 根据各块的帧数比例切分音频, 输入没有 padding 时最后一块保留到结尾
+        size_t audio_len = job.audio.size();
+        for (auto& seg : job.segments) {
+            seg.begin_sample = size_t(audio_len * (seg.begin_frame * 1.0f / job.total_frames));
+            if (seg.offset + seg.len >= job.seq_len) {
+                seg.end_sample = audio_len;
+            } else {
+                seg.end_sample = size_t(audio_len * (seg.end_frame * 1.0f / job.total_frames));
+            }
+            seg.end_sample = std::min(std::max(seg.end_sample, seg.begin_sample), audio_len);
+
+            // 只在请求的最后一块末尾淡出
+            if (seg.item >= 0 && seg.is_last && job.fade_samples > 0) {
+                apply_fade_out_(job.audio.data() + seg.begin_sample, seg.end_sample - seg.begin_sample, job.fade_samples);
+            }
+        }
     }
 
-    bool inference_single_chunk_(
+    bool infer_front_(
+        KokoroContext& ctx,
+        KokoroBucket& bucket,
         std::vector<int>& input_ids,
         const std::vector<float>& ref_s,
         int actual_len,
         float speed,
-        std::vector<float>& audio,
-        int& actual_content_frames,
-        int& total_frames
+        ChunkJob& job
     ) {
         int ret = 0;
-        // Prepare inputs
-        bool is_doubled = false;
-        int original_actual_len = actual_len;
-
-        prepare_input_ids_(input_ids, actual_len, is_doubled);
-
-        std::vector<int> input_lengths;
-        std::vector<uint8_t> text_mask;
-        compute_external_preprocessing_(input_ids, actual_len, input_lengths, text_mask);
-
+        int total_frames = 0;
+        int seq_len = bucket.seq_len;
+        AxModelRunner& model1 = bucket.model1;
+        AxModelRunner& model2 = bucket.model2;
+        AxModelRunner& model3 = bucket.model3;
+        TraceTag tag;
+        tag.pass = job.pass_id;
+
+        // 输入直接写进 CMM 缓冲. input_ids/ref_s 与 model2/model3 共享缓冲, 见 load_bucket_
         // outputs1 = self.session1.run(None, {'input_ids': input_ids.astype(np.int32), 'ref_s': ref_s, 'text_mask': text_mask.astype(np.uint8)})
-        std::vector<void*> model1_inputs{(void*)input_ids.data(), (void*)ref_s.data(), (void*)text_mask.data()};
-        std::vector<void*> model1_outputs{(void*)duration_.data(), (void*)d_.data()};
+        std::memcpy(model1.get_input_ptr(0), input_ids.data(), model1.get_input_size(0));
+        std::memcpy(model1.get_input_ptr(1), ref_s.data(), model1.get_input_size(1));
+        compute_text_mask_(model1.get_input_data<uint8_t>(2), seq_len, actual_len);
 
-        // printf("run model 1\n");
-        model1_.set_inputs(model1_inputs);
-        ret = model1_.run();
+        {
+            ScopedStageTimer timer(stats_of_(ctx), AX_TTS_STAGE_MODEL1, tag);
+            ret = model1.run();
+        }
         if (0 != ret) {
             ALOGE("Run model1 failed! ret=0x%x", ret);
             return false;
         }
-        model1_.get_outputs(model1_outputs);
 
         // 处理duration并对齐
-        std::vector<int> pred_dur;
-        process_duration_(duration_, actual_len, speed, pred_dur, total_frames);
-        auto pred_aln_trg = create_alignment_matrix_(pred_dur, total_frames);
+        auto align_start = TTSStats::Clock::now();
+        std::vector<int>& pred_dur = ctx.workspace.pred_dur;
+        process_duration_(ctx, model1.get_output_data<float>(0), bucket.duration_shape[2], seq_len, 
+            actual_len, speed, pred_dur, total_frames);
+
+        // model2 的对齐矩阵和 en 按模型的固定帧数排布, 多出的帧补 0
+        int aln_frames = bucket.aln_shape[2];
+        if (total_frames > aln_frames) {
+            ALOGE("total_frames %d exceed model frames %d", total_frames, aln_frames);
+            return false;
+        }
+        create_alignment_matrix_(pred_dur, seq_len, aln_frames, model2.get_input_data<float>(4));
 
         // Model2: 预测F0和ASR特征
         // d_transposed = np.transpose(d, (0, 2, 1))
         // en = d_transposed @ pred_aln_trg
-        DynMat M_d = Eigen::Map<DynMat>(
-            d_.data(), 
-            d_shape_[1],  // 96
-            d_shape_[2]   // 640
-        );
-        
-        DynMat M_pred_aln_trg = Eigen::Map<DynMat>(
-            pred_aln_trg.data(), 
-            max_seq_len_,  // 96
-            total_frames   // 192
-        );
+        // pred_aln_trg 每列只有一个 1, 矩阵乘法等价于按 pred_dur 重复 d 的行
+        expand_by_duration_(model1.get_output_data<float>(1), bucket.d_shape[2], pred_dur, 
+            aln_frames, model2.get_input_data<float>(0));
 
-        DynMat M_en = M_d.transpose() * M_pred_aln_trg;
-        std::vector<float> en(M_en.size());
-        std::memcpy(en.data(), M_en.data(), M_en.size() * sizeof(float));
-
-        std::vector<float> text_mask_float;
-        std::transform(text_mask.begin(), text_mask.end(),
-                    std::back_inserter(text_mask_float),
-                    [](uint8_t i) { return static_cast<float>(i); });
+        float* text_mask_float = model2.get_input_data<float>(3);
+        for (int i = 0; i < seq_len; i++) {
+            text_mask_float[i] = (i >= actual_len) ? 1.0f : 0.0f;
+        }
+        if (TTSStats* stats = stats_of_(ctx)) {
+            stats->record(AX_TTS_STAGE_ALIGNMENT, align_start, tag);
+        }
 
         // F0_pred, N_pred, asr = outputs2
-        std::vector<void*> model2_inputs{
-            (void*)en.data(), 
-            (void*)ref_s.data(), 
-            (void*)input_ids.data(),
-            (void*)text_mask_float.data(), 
-            (void*)pred_aln_trg.data()
-        };
-        std::vector<void*> model2_outputs{
-            (void*)F0_pred_.data(),
-            (void*)N_pred_.data(), 
-            (void*)asr_.data()
-        };
-
-        model2_.set_inputs(model2_inputs);
-        ret = model2_.run();
+        sync_links_(bucket, &model2);
+        {
+            ScopedStageTimer timer(stats_of_(ctx), AX_TTS_STAGE_MODEL2, tag);
+            ret = model2.run();
+        }
         if (0 != ret) {
             ALOGE("Run model2 failed! ret=0x%x", ret);
             return false;
         }
-        model2_.get_outputs(model2_outputs);
 
-        std::vector<float> har;
-        compute_har_onnx_(F0_pred_, har);
+        // 各块的帧范围, 后处理按它切分音频
+        for (auto& seg : job.segments) {
+            seg.begin_frame = std::accumulate(pred_dur.begin(), pred_dur.begin() + seg.offset, 0);
+            seg.end_frame = seg.begin_frame + 
+                std::accumulate(pred_dur.begin() + seg.offset, pred_dur.begin() + seg.offset + seg.len, 0);
+        }
+        job.total_frames = total_frames;
 
-        std::vector<void*> model3_inputs{
-            (void*)asr_.data(), 
-            (void*)F0_pred_.data(), 
-            (void*)N_pred_.data(),
-            (void*)ref_s.data(), 
-            (void*)har.data()
-        };
+        return true;
+    }
 
-        // printf("run model 3\n");
-        model3_.set_inputs(model3_inputs);
-        ret = model3_.run();
+    // restore 时 model3 的输入从 job 中写回, 否则直接用 model2 的输出
+    bool run_model3_(KokoroContext& ctx, ChunkJob& job, bool restore) {
+        KokoroBucket& bucket = *job.bucket;
+        AxModelRunner& model3 = bucket.model3;
+        TraceTag tag;
+        tag.pass = job.pass_id;
+
+        if (restore) {
+            restore_model3_inputs_(job);
+        } else {
+            // asr, F0_pred, N_pred 与 model2 的输出共享缓冲
+            sync_links_(bucket, &model3);
+        }
+
+        int ret = 0;
+        {
+            ScopedStageTimer timer(stats_of_(ctx), AX_TTS_STAGE_MODEL3, tag);
+            ret = model3.run();
+        }
         if (0 != ret) {
             ALOGE("Run model3 failed! ret=0x%x", ret);
             return false;
         }
-        model3_.get_output(0, x_.data());
+        // 输出拷到 job 中, 后处理与下一块的推理并行时不会被覆盖
+        const float* x = model3.get_output_data<float>(0);
+        job.x.assign(x, x + bucket.x_size);
+        return true;
+    }
 
-        // 转换为音频
-        postprocess_x_to_audio_(x_, audio);
-        
-        if (is_doubled) {
-            actual_content_frames = std::accumulate(pred_dur.begin(), pred_dur.begin() + original_actual_len, 0);   
-            size_t audio_len = audio.size();
-            audio.erase(audio.begin() + audio_len / 2, audio.end());
-            total_frames = total_frames / 2;
-        } else {
-            actual_content_frames = std::accumulate(pred_dur.begin(), pred_dur.begin() + actual_len, 0);
+    void link_tensor_(KokoroBucket& bucket, AxModelRunner* src, int src_index, bool src_is_output,
+                      AxModelRunner* dst, int dst_index) {
+        // 优先共享 CMM 缓冲, 大小不一致时退化为运行前拷贝
+        int ret = src_is_output ? dst->share_input_with_output(dst_index, *src, src_index)
+                                : dst->share_input_with_input(dst_index, *src, src_index);
+        if (ret != 0) {
+            ALOGW("Tensor of bucket %d can not be shared, fall back to copy", bucket.seq_len);
+            bucket.copy_links.push_back(TensorLink{src, src_index, src_is_output, dst, dst_index});
         }
-
-        return true;
     }
 
-    void trim_audio_by_content_(std::vector<float>& audio, int actual_content_frames, int total_frames, int actual_len) {
-        // 根据实际内容比例裁剪音频
-        int padding_len = max_seq_len_ - actual_len;
-        if (padding_len > 0) {
-            float content_ratio = actual_content_frames * 1.0f / total_frames;
-            int audio_len_to_keep = int(audio.size() * content_ratio);
-            audio.resize(audio_len_to_keep);
+    void sync_links_(KokoroBucket& bucket, AxModelRunner* dst) {
+        for (const auto& link : bucket.copy_links) {
+            if (link.dst != dst)
+                continue;
+
+            void* src = link.src_is_output ? link.src->get_output_ptr(link.src_index) 
+                                           : link.src->get_input_ptr(link.src_index);
+            size_t size = std::min(dst->get_input_size(link.dst_index), 
+                link.src_is_output ? link.src->get_output_size(link.src_index) : link.src->get_input_size(link.src_index));
+            std::memcpy(dst->get_input_ptr(link.dst_index), src, size);
         }
     }
 
-    void apply_fade_out_(std::vector<float>& audio, int fade_samples) {
+    void apply_fade_out_(float* audio, size_t len, int fade_samples) {
         // 末尾淡出音频
-        if (audio.size() <= fade_samples || fade_samples <= 0)
+        if (len <= fade_samples || fade_samples <= 0)
             return;
 
-        std::vector<float> fade_out = linspace(1.0f, 0.0f, fade_samples);
+        // fade_out = np.linspace(1.0, 0.0, fade_samples)
         // audio_faded = audio.copy()
         // audio_faded[-fade_samples:] *= fade_out
         // return audio_faded
+        float step = fade_samples > 1 ? 1.0f / (fade_samples - 1) : 0.0f;
         for (int i = 0; i < fade_samples; i++) {
-            audio[i - fade_samples + audio.size()] *= fade_out[i];
-        }
-    }
-
-    void prepare_input_ids_(std::vector<int>& input_ids, int& actual_len, bool& is_doubled) {
-        // 准备输入ID，对短输入进行复制处理
-        is_doubled = false;
-        int original_actual_len = actual_len;
-
-        // printf("actual_len 3: %d\n", actual_len);
-        if (actual_len <= DOUBLE_INPUT_THRESHOLD) {
-            // printf("doubled!\n");
-            is_doubled = true;
-            // valid_content = input_ids[:, :actual_len]
-            std::vector<int> valid_content(input_ids.begin(), input_ids.begin() + actual_len);
-            // input_ids_doubled = np.concatenate([valid_content, valid_content], axis=1)
-            std::vector<int> input_ids_doubled;
-            // input_ids_doubled.reserve(2 * actual_len);
-            input_ids_doubled.insert(input_ids_doubled.end(), valid_content.begin(), valid_content.end());
-            input_ids_doubled.insert(input_ids_doubled.end(), valid_content.begin(), valid_content.end());
-            
-            // padding_len = self.max_seq_len_ - input_ids_doubled.shape[1]
-            int padding_len = max_seq_len_ - 2 * actual_len;
-            // printf("padding_len: %d\n", padding_len);
-            if (padding_len > 0) {
-                // input_ids = np.concatenate([input_ids_doubled, np.zeros((1, padding_len), dtype=input_ids.dtype)], axis=1)
-                std::vector<int> padding(padding_len, 0);
-                input_ids_doubled.insert(input_ids_doubled.end(), padding.begin(), padding.end());
-            }
-            else {
-                // input_ids = input_ids_doubled[:, :self.max_seq_len_]
-                input_ids_doubled.resize(max_seq_len_);
-            }
-
-            // save_file(input_ids_doubled, "input_ids2_1.bin");
-                
-            input_ids = input_ids_doubled;
-            actual_len = std::min(original_actual_len * 2, max_seq_len_);
+            audio[i - fade_samples + len] *= 1.0f - i * step;
         }
     }
 
-    void compute_external_preprocessing_(const std::vector<int>& input_ids, int actual_len, std::vector<int>& input_lengths, std::vector<uint8_t>& text_mask) {
-        // 计算输入预处理：长度和mask
+    void compute_text_mask_(uint8_t* text_mask, int seq_len, int actual_len) {
+        // 计算输入预处理：mask
         // input_lengths = np.full((input_ids.shape[0],), actual_len, dtype=np.int64)
-        input_lengths = std::vector<int>{actual_len};
         // text_mask = np.arange(self.max_seq_len_)[np.newaxis, :] >= input_lengths[:, np.newaxis]
-        text_mask.resize(max_seq_len_);
-        for (int i = 0; i < max_seq_len_; i++) {
+        for (int i = 0; i < seq_len; i++) {
             text_mask[i] = (i >= actual_len) ? 1 : 0;
         }
     }
 
-    void process_duration_(const std::vector<float>& duration, int actual_len, float speed, std::vector<int>& pred_dur, int& total_frames) {
+    void process_duration_(KokoroContext& ctx, const float* duration, int duration_dim, int seq_len, int actual_len, float speed, std::vector<int>& pred_dur, int& total_frames) {
         // """处理duration预测，调整到固定帧数"""
         // duration_processed = 1.0 / (1.0 + np.exp(-duration))
         // duration_processed = duration_processed.sum(axis=-1) / speed
         // pred_dur_original = np.round(duration_processed).clip(min=1).astype(np.int64).squeeze()
-        std::vector<int> pred_dur_original(actual_len, 0);
-        std::vector<float> duration_processed = sigmoid(duration);
+        //
+        // # 分离实际内容和padding
+        // pred_dur_actual = pred_dur_original[:actual_len]
+        // pred_dur_padding = np.zeros(self.max_seq_len_ - actual_len, dtype=np.int64)
+        // pred_dur = np.concatenate([pred_dur_actual, pred_dur_padding])
+        pred_dur.assign(seq_len, 0);
         for (int i = 0; i < actual_len; i++) {
             float sum = 0;
 
             // duration shape: [1, 96, 50]
-            for (int n = 0; n < duration_shape_[2]; n++) {
-                sum += duration_processed[i * duration_shape_[2] + n];
+            const float* row = duration + i * duration_dim;
+            for (int n = 0; n < duration_dim; n++) {
+                sum += sigmoid(row[n]);
             }
             sum /= speed;
 
-            pred_dur_original[i] = int(std::max(1.f, roundf(sum)));
+            pred_dur[i] = int(std::max(1.f, roundf(sum)));
         }
 
-        // # 分离实际内容和padding
-        // pred_dur_actual = pred_dur_original[:actual_len]
-        // pred_dur_padding = np.zeros(self.max_seq_len_ - actual_len, dtype=np.int64)
-        // pred_dur = np.concatenate([pred_dur_actual, pred_dur_padding])
-        std::vector<int> pred_dur_padding(max_seq_len_ - actual_len, 0);
-        pred_dur = pred_dur_original;
-        pred_dur.insert(pred_dur.end(), pred_dur_padding.begin(), pred_dur_padding.end());
-
         
         // # 调整实际内容部分，只处理长度超出情况
         // fixed_total_frames = self.max_seq_len_ * 2
@@ -604,13 +1789,14 @@ private:
         //             break
 
         // 调整实际内容部分，只处理长度超出情况
-        int fixed_total_frames = max_seq_len_ * 2;
+        int fixed_total_frames = seq_len * 2;
         int actual_frames = std::accumulate(pred_dur.begin(), pred_dur.begin() + actual_len, 0);
         int diff = fixed_total_frames - actual_frames;
 
         if (diff < 0) {
             // 减少帧数
-            auto indices = argsort(pred_dur, actual_len, true);
+            auto& indices = ctx.workspace.sort_idx;
+            argsort(pred_dur, actual_len, true, indices);
             int decreased = 0;
             for (auto idx : indices) {
                 if (pred_dur[idx] > 1 && decreased < std::abs(diff)) {
@@ -634,10 +1820,7 @@ private:
 
         actual_frames = std::accumulate(pred_dur.begin(), pred_dur.begin() + actual_len, 0);
         int remaining_frames = fixed_total_frames - actual_frames;
-        int padding_len = max_seq_len_ - actual_len;
-        // printf("actual_len 4: %d\n ", actual_len);
-        // printf("remaining_frames 4: %d\n", remaining_frames);
-        // printf("padding_len 4: %d\n", padding_len);
+        int padding_len = seq_len - actual_len;
 
         if (remaining_frames > 0 && padding_len > 0) {
             int frames_per_padding = remaining_frames / padding_len;
@@ -654,120 +1837,141 @@ private:
         
         // total_frames = pred_dur.sum()
         total_frames = std::accumulate(pred_dur.begin(), pred_dur.end(), 0);
-        // printf("total_frames: %d\n", total_frames);
     }
 
-    std::vector<float> create_alignment_matrix_(const std::vector<int>& pred_dur, int total_frames) {
+    void create_alignment_matrix_(const std::vector<int>& pred_dur, int seq_len, int total_frames, float* pred_aln_trg) {
         // """创建对齐矩阵"""
         // indices = np.repeat(np.arange(self.max_seq_len_), pred_dur)
         // pred_aln_trg = np.zeros((self.max_seq_len_, total_frames), dtype=np.float32)
         // if len(indices) > 0:
         //     pred_aln_trg[indices, np.arange(total_frames)] = 1.0
         // return pred_aln_trg[np.newaxis, ...]
+        std::fill(pred_aln_trg, pred_aln_trg + seq_len * total_frames, 0.0f);
 
-        std::vector<int> seq_range(max_seq_len_);
-        std::iota(seq_range.begin(), seq_range.end(), 0);
-        auto indices = np_repeat(seq_range, pred_dur);
-
-        std::vector<float> pred_aln_trg(max_seq_len_ * total_frames);
-        if (!indices.empty()) {
-            int col = 0;
-            for (auto i : indices) {
+        int col = 0;
+        for (int i = 0; i < seq_len && i < pred_dur.size(); i++) {
+            for (int n = 0; n < pred_dur[i] && col < total_frames; n++) {
                 pred_aln_trg[i * total_frames + col] = 1.0f;
                 col++;
             }
         }
+    }
 
-        return pred_aln_trg;
+    void expand_by_duration_(const float* d, int channels, const std::vector<int>& pred_dur, int total_frames, float* en) {
+        // d: [seq_len, channels], en: [channels, total_frames]
+        // en[c, f] = d[t, c], 其中第 f 帧属于第 t 个 token
+        for (int c = 0; c < channels; c++) {
+            float* row = en + c * total_frames;
+            int frame = 0;
+            for (size_t t = 0; t < pred_dur.size() && frame < total_frames; t++) {
+                int n = std::min(pred_dur[t], total_frames - frame);
+                std::fill(row + frame, row + frame + n, d[t * channels + c]);
+                frame += n;
+            }
+            std::fill(row + frame, row + total_frames, 0.0f);
+        }
     }
 
-    void compute_har_onnx_(std::vector<float>& F0_pred, std::vector<float>& har) {
-        // Querying model inputs is possible but let's just assume one set for this translation or use a check.
-        // For brevity, I'll use the older "tokens" set as default or try to match python logic if I can access names.
-        int64_t input_shape[] = {F0_pred_shape_[0], F0_pred_shape_[1]};
-        std::vector<const char*> input_names = {"F0_pred"};
+    bool compute_har_(KokoroContext& ctx, float* F0_pred, const std::vector<int>& F0_pred_shape, 
+                      float* har, const std::vector<int>& har_shape) {
+#ifdef WITH_ONNXRUNTIME
+        if (!ctx.har.loaded()) {
+            return compute_har_onnx_(F0_pred, F0_pred_shape, har, har_shape);
+        }
+#endif
+        // F0_pred: [1, f0_len], har: [1, N_FFT + 2, num_frames]
+        int f0_len = std::accumulate(F0_pred_shape.begin(), F0_pred_shape.end(), 1, std::multiplies<int>());
+        if (!ctx.har.run(F0_pred, f0_len, har, har_shape.back())) {
+            ALOGE("Compute har failed!");
+            return false;
+        }
+        return true;
+    }
+
+#ifdef WITH_ONNXRUNTIME
+    // 用这组模型的 F0 和 har 形状对比原生实现和 onnx 模型, 误差写到日志
+    bool check_native_har_(const KokoroBucket& bucket) {
+        int f0_len = std::accumulate(bucket.F0_pred_shape.begin(), bucket.F0_pred_shape.end(), 1, std::multiplies<int>());
+        int num_frames = bucket.har_shape.back();
+        size_t har_size = std::accumulate(bucket.har_shape.begin(), bucket.har_shape.end(), (size_t)1, std::multiplies<size_t>());
+
+        std::vector<float> f0 = KokoroHar::make_test_f0(f0_len);
+        std::vector<float> expected(har_size), actual(har_size);
+        if (!compute_har_onnx_(f0.data(), bucket.F0_pred_shape, expected.data(), bucket.har_shape) ||
+            !har_.run(f0.data(), f0_len, actual.data(), num_frames)) {
+            ALOGW("Check native HAR failed, use onnxruntime");
+            return false;
+        }
+
+        float mag_err = 0, phase_err = 0;
+        if (!har_.compare(expected.data(), actual.data(), num_frames, mag_err, phase_err)) {
+            ALOGW("Native HAR differs from onnxruntime: magnitude error %g (tolerance %g), phase error %g rad (tolerance %g), "
+                  "use onnxruntime", mag_err, HAR_MAG_TOLERANCE, phase_err, HAR_PHASE_TOLERANCE);
+            return false;
+        }
+
+        ALOGI("Native HAR matches onnxruntime: magnitude error %g, phase error %g rad", mag_err, phase_err);
+        return true;
+    }
+
+    bool compute_har_onnx_(float* F0_pred, const std::vector<int>& F0_pred_shape, 
+                           float* har, const std::vector<int>& har_shape) {
+        // 输入输出都直接绑定到 NPU 的 CMM 缓冲, ORT 不再分配输出
+        std::vector<int64_t> input_shape(F0_pred_shape.begin(), F0_pred_shape.end());
+        std::vector<int64_t> output_shape(har_shape.begin(), har_shape.end());
+        size_t input_count = std::accumulate(input_shape.begin(), input_shape.end(), (int64_t)1, std::multiplies<int64_t>());
+        size_t output_count = std::accumulate(output_shape.begin(), output_shape.end(), (int64_t)1, std::multiplies<int64_t>());
+
+        const char* input_names[] = {"F0_pred"};
+        const char* output_names[] = {"har"};
 
-        std::vector<Ort::Value> input_tensors;
-        
-        // Create tensors
         auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
-        
-        input_tensors.push_back(Ort::Value::CreateTensor<float>(
-            memory_info, F0_pred.data(), F0_pred.size(), input_shape, F0_pred_shape_.size()));
-
-        // Check model output name usually
-        // Or get it from session
-        std::vector<const char*> output_names = {"har"};
-
-        auto output_tensors = model4_.Run(
-            Ort::RunOptions{nullptr},
-            input_names.data(),
-            input_tensors.data(),
-            input_tensors.size(),
-            output_names.data(),
-            output_names.size()
-        );
-
-        auto& output_tensor = output_tensors.front();
-                
-        // 获取输出信息
-        auto tensor_info = output_tensor.GetTensorTypeAndShapeInfo();
-        size_t element_count = tensor_info.GetElementCount();
-        auto output_shape = tensor_info.GetShape();
-        
-        float* output_data = output_tensor.GetTensorMutableData<float>();
-        
-        har.resize(element_count);
-        std::memcpy(har.data(), output_data, element_count * sizeof(float));
+        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
+            memory_info, F0_pred, input_count, input_shape.data(), input_shape.size());
+        Ort::Value output_tensor = Ort::Value::CreateTensor<float>(
+            memory_info, har, output_count, output_shape.data(), output_shape.size());
+
+        try {
+            model4_.Run(
+                Ort::RunOptions{nullptr},
+                input_names, &input_tensor, 1,
+                output_names, &output_tensor, 1
+            );
+        } catch (const Ort::Exception& e) {
+            ALOGE("Run model4 failed! %s", e.what());
+            return false;
+        }
+
+        return true;
     }
+#endif
 
-    void postprocess_x_to_audio_(std::vector<float>& x, std::vector<float>& audio) {
+    void postprocess_x_to_audio_(KokoroContext& ctx, const std::vector<float>& x, int num_frames, std::vector<float>& audio) {
         // 将频谱转换为音频波形
         // spec_part = x[:, :self.N_FFT//2+1, :]
         // phase_part = x[:, self.N_FFT//2+1:, :]
         int half_n_fft = N_FFT / 2 + 1;
-        int num_frames = x_shape_[2];
-        std::vector<float> spec_part(half_n_fft * num_frames);
-        std::vector<float> phase_part(half_n_fft * num_frames);
-        std::vector<float> cos_part(half_n_fft * num_frames);
-        spec_part.assign(x.begin(), x.begin() + half_n_fft * num_frames);
-        phase_part.assign(x.begin() + half_n_fft * num_frames, x.end());
-        
         // spec = np.exp(spec_part)
         // phase = np.sin(phase_part)
-        
-        // spec_torch = torch.from_numpy(spec).float()
-        // phase_torch = torch.from_numpy(phase).float()
         // cos_part = torch.sqrt(1.0 - phase_torch.pow(2).clamp(0, 1))
-        
         // real = spec_torch * cos_part
         // imag = spec_torch * phase_torch
-        // complex_spec = torch.complex(real, imag)
-
-        for (int i = 0; i < half_n_fft * num_frames; i++) {
-            spec_part[i] = expf(spec_part[i]);
-            phase_part[i] = sinf(phase_part[i]);
-            cos_part[i] = sqrtf(1.f - std::max(0.f, std::min(powf(phase_part[i], 2), 1.0f)));
-        }
-
-        FFT_RESULT complex_spec(half_n_fft, vector<complex<float>>(num_frames));
-        for (int i = 0; i < half_n_fft; i++) {
-            for (int n = 0; n < num_frames; n++) {
-                float spec = spec_part[i * num_frames + n];
-
-                float real_part = spec * cos_part[i * num_frames + n];
-                float imag_part = spec * phase_part[i * num_frames + n];
-
-                complex_spec[i][n] = std::complex<float>(real_part, imag_part);
-            }
-        }
+        // 同一时刻只有一个后处理在跑, 可以直接复用工作区
+        size_t spec_len = half_n_fft * num_frames;
+        std::vector<float>& spec_real = ctx.workspace.spec_real;
+        std::vector<float>& spec_imag = ctx.workspace.spec_imag;
+        spec_real.resize(spec_len);
+        spec_imag.resize(spec_len);
+        utils::mag_phase_to_complex(x.data(), x.data() + spec_len, spec_len, spec_real.data(), spec_imag.data());
 
         // audio = torch.istft(
         //     complex_spec, n_fft=self.N_FFT, hop_length=self.HOP_LENGTH,
         //     win_length=self.N_FFT, window=torch.hann_window(self.N_FFT),
         //     center=True, return_complex=False
         // )
-        audio = librosa::Feature::istft(complex_spec, N_FFT, HOP_LENGTH, "hann", true, "reflect", false);
+        utils::SmallISTFT& istft = ctx.workspace.istft;
+        audio.resize(istft.output_length(num_frames));
+        istft.run(spec_real.data(), spec_imag.data(), num_frames, audio.data());
     }
 
 private:
@@ -775,16 +1979,29 @@ private:
 
     int max_seq_len_;
     std::map<std::string, int> vocab_;
+    std::set<int> vocab_ids_;   // 检查 run_tokens 的输入
+    std::set<int> sentence_end_ids_;
+    std::set<int> clause_mark_ids_;
+    int space_id_;
     std::string voice_path_;
-    std::string voice_name_;
-    std::vector<float> voice_tensor_;
-
-    AxModelRunner model1_, model2_, model3_;
+    std::map<std::string, std::shared_ptr<const std::vector<float>>> voices_;
+    std::mutex voices_mutex_;
+    TTSStats stats_;    // 所有上下文共用, 无锁写入
+    std::atomic<int64_t> next_request_id_{0};   // 追踪事件中的请求号和推理批次号
+    std::atomic<int64_t> next_pass_id_{0};
+
+    // contexts_[0] 持有模型句柄, 其余上下文 attach 到它的模型上
+    std::vector<std::unique_ptr<KokoroContext>> contexts_;
+    std::vector<KokoroContext*> free_contexts_;
+    std::mutex contexts_mutex_;
+    std::condition_variable contexts_cv_;
+    std::mutex warmup_mutex_;
+
+    KokoroHar har_{MODEL_SAMPLE_RATE, N_FFT, HOP_LENGTH};   // 加载的权重, 每个上下文拷一份
+#ifdef WITH_ONNXRUNTIME
     Ort::Env env_;
     Ort::Session model4_{nullptr};
-    Ort::AllocatorWithDefaultOptions allocator_;
-    std::vector<float> duration_, d_, F0_pred_, N_pred_, asr_, x_;
-    std::vector<int> duration_shape_, d_shape_, F0_pred_shape_, x_shape_;
+#endif
 };
 
 
@@ -807,4 +2024,43 @@ void Kokoro::uninit(void) {
 
 bool Kokoro::run(const std::string& text, AX_TTS_RUN_CONFIG* config, AX_TTS_AUDIO** audio) {
     return impl_->run(text, config, audio);
+}
+
+bool Kokoro::run_phonemes(const std::string& phonemes, AX_TTS_RUN_CONFIG* config, AX_TTS_AUDIO** audio) {
+    return impl_->run_phonemes(phonemes, config, audio);
+}
+
+bool Kokoro::run_tokens(const std::vector<int>& tokens, AX_TTS_RUN_CONFIG* config, AX_TTS_AUDIO** audio) {
+    return impl_->run_tokens(tokens, config, audio);
+}
+
+bool Kokoro::run_into(const std::string& text, AX_TTS_RUN_CONFIG* config, 
+                      void* buffer, int buffer_len, int* num_samples) {
+    return impl_->run_into(text, config, buffer, buffer_len, num_samples);
+}
+
+bool Kokoro::run_stream(const std::string& text, AX_TTS_RUN_CONFIG* config, 
+                        AX_TTS_STREAM_CALLBACK callback, void* user_data) {
+    return impl_->run_stream(text, config, callback, user_data);
+}
+
+bool Kokoro::run_batch(const std::vector<std::string>& texts, AX_TTS_RUN_CONFIG* config, 
+                       const BatchDoneHandler& on_done) {
+    return impl_->run_batch(texts, config, on_done);
+}
+
+void Kokoro::get_stats(AX_TTS_STATS* stats, bool reset) {
+    impl_->get_stats(stats, reset);
+}
+
+bool Kokoro::warmup(const std::vector<std::string>& voices) {
+    return impl_->warmup(voices);
+}
+
+bool Kokoro::start_trace(const std::string& path) {
+    return impl_->start_trace(path);
+}
+
+bool Kokoro::stop_trace() {
+    return impl_->stop_trace();
 }
\ No newline at end of file
@@ -21,6 +21,18 @@ public:
     bool init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG* init_config);
     void uninit(void);
     bool run(const std::string& text, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio);
+    bool run_phonemes(const std::string& phonemes, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio);
+    bool run_tokens(const std::vector<int>& tokens, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio);
+    bool run_into(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                  void* buffer, int buffer_len, int* num_samples);
+    bool run_stream(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                    AX_TTS_STREAM_CALLBACK callback, void* user_data);
+    bool run_batch(const std::vector<std::string>& texts, AX_TTS_RUN_CONFIG* run_config, 
+                   const BatchDoneHandler& on_done);
+    bool warmup(const std::vector<std::string>& voices);
+    void get_stats(AX_TTS_STATS* stats, bool reset);
+    bool start_trace(const std::string& path);
+    bool stop_trace();
 
 private:
     class Impl;
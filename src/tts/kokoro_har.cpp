@@ -0,0 +1,187 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "tts/kokoro_har.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include "utils/logger.h"
+#include "utils/memory_utils.hpp"
+
+// SineGen 参数, 与 kokoro istftnet.py 一致
+#define SINE_AMP            0.1f
+#define VOICED_THRESHOLD    10.0f
+
+static const double PI = 3.14159265358979323846;
+
+KokoroHar::KokoroHar(int sample_rate, int n_fft, int hop_length)
+    : sample_rate_(sample_rate),
+      n_fft_(n_fft),
+      n_freq_(n_fft / 2 + 1),
+      hop_(hop_length) {
+    // torch.hann_window(n_fft), 周期窗
+    window_cos_.resize(n_freq_ * n_fft_);
+    window_sin_.resize(n_freq_ * n_fft_);
+    for (int n = 0; n < n_fft_; n++) {
+        double window = 0.5 * (1.0 - cos(2.0 * PI * n / n_fft_));
+        for (int k = 0; k < n_freq_; k++) {
+            // DC 和 Nyquist 的虚部严格为 0, 相位的符号才和参考实现一致
+            int m = (k * n) % n_fft_;
+            double c = cos(2.0 * PI * m / n_fft_);
+            double s = -sin(2.0 * PI * m / n_fft_);
+            if (m == 0 || 2 * m == n_fft_) {
+                c = (m == 0) ? 1.0 : -1.0;
+                s = 0.0;
+            }
+            window_cos_[k * n_fft_ + n] = float(window * c);
+            window_sin_[k * n_fft_ + n] = float(window * s);
+        }
+    }
+}
+
+bool KokoroHar::load(const std::string& weights_path) {
+    std::vector<char> data;
+    if (!utils::read_file(weights_path, data)) {
+        ALOGE("Read %s failed", weights_path.c_str());
+        return false;
+    }
+
+    // 至少包含基频的一个权重和 bias
+    size_t count = data.size() / sizeof(float);
+    if (data.size() % sizeof(float) != 0 || count < 2) {
+        ALOGE("Invalid har weights %s, size %d", weights_path.c_str(), (int)data.size());
+        return false;
+    }
+
+    const float* values = reinterpret_cast<const float*>(data.data());
+    weights_.assign(values, values + count - 1);
+    bias_ = values[count - 1];
+    ALOGI("Loaded har weights with %d harmonics", (int)weights_.size());
+    return true;
+}
+
+bool KokoroHar::run(const float* f0, int f0_len, float* har, int num_frames) {
+    if (!loaded()) {
+        ALOGE("Har weights not loaded");
+        return false;
+    }
+
+    int source_len = (num_frames - 1) * hop_;
+    if (f0_len <= 0 || source_len <= 0 || source_len % f0_len != 0) {
+        ALOGE("Har frames %d do not match F0 length %d", num_frames, f0_len);
+        return false;
+    }
+
+    sine_merge_(f0, f0_len, source_len / f0_len);
+    stft_(har, num_frames);
+    return true;
+}
+
+void KokoroHar::sine_merge_(const float* f0, int f0_len, int upsample) {
+    int pad = n_fft_ / 2;
+    int len = f0_len * upsample;
+    source_.assign(len + 2 * pad, 0.0f);
+    phase_.resize(f0_len);
+    float* source = source_.data() + pad;
+
+    const float pi = float(PI);
+    for (size_t h = 0; h < weights_.size(); h++) {
+        // rad_values = (f0 * (h + 1) / sr) % 1
+        // f0 是最近邻上采样的, 按 1/upsample 线性下采样后正好取回每个 f0 的值
+        // phase = cumsum(rad_values) * 2 * pi * upsample
+        float cumsum = 0.0f;
+        for (int i = 0; i < f0_len; i++) {
+            float rad = f0[i] * float(h + 1) / float(sample_rate_);
+            rad = rad - floorf(rad);
+            cumsum += rad;
+            phase_[i] = cumsum * 2.0f * pi * float(upsample);
+        }
+
+        // F.interpolate(mode="linear", align_corners=False) 上采样回采样率
+        float weight = weights_[h];
+        for (int j = 0; j < len; j++) {
+            float x = std::max(0.0f, (j + 0.5f) / float(upsample) - 0.5f);
+            int i0 = int(x);
+            int i1 = std::min(i0 + 1, f0_len - 1);
+            float dx = x - i0;
+            float phase = phase_[i0] * (1.0f - dx) + phase_[i1] * dx;
+
+            // 清音部分只剩噪声, sim 模型里噪声为 0
+            bool voiced = f0[j / upsample] > VOICED_THRESHOLD;
+            if (voiced) {
+                source[j] += sinf(phase) * SINE_AMP * weight;
+            }
+        }
+    }
+
+    // sine_merge = tanh(l_linear(sine_wavs))
+    for (int j = 0; j < len; j++) {
+        source[j] = tanhf(source[j] + bias_);
+    }
+
+    // torch.stft(center=True) 的反射补齐
+    for (int m = 0; m < pad; m++) {
+        source[-1 - m] = source[1 + m];
+        source[len + m] = source[len - 2 - m];
+    }
+}
+
+void KokoroHar::stft_(float* har, int num_frames) {
+    float* magnitude = har;
+    float* phase = har + n_freq_ * num_frames;
+    for (int t = 0; t < num_frames; t++) {
+        const float* frame = source_.data() + t * hop_;
+        for (int k = 0; k < n_freq_; k++) {
+            const float* c = window_cos_.data() + k * n_fft_;
+            const float* s = window_sin_.data() + k * n_fft_;
+            float re = 0.0f, im = 0.0f;
+            for (int n = 0; n < n_fft_; n++) {
+                re += frame[n] * c[n];
+                im += frame[n] * s[n];
+            }
+            magnitude[k * num_frames + t] = sqrtf(re * re + im * im);
+            phase[k * num_frames + t] = atan2f(im, re);
+        }
+    }
+}
+
+bool KokoroHar::compare(const float* expected, const float* actual, int num_frames, float& mag_err, float& phase_err) const {
+    // 相位只在幅度明显非零的 bin 上比较, 否则 atan2 的结果没有意义
+    int count = n_freq_ * num_frames;
+    float max_mag = 0;
+    for (int i = 0; i < count; i++) {
+        max_mag = std::max(max_mag, fabsf(expected[i]));
+    }
+
+    mag_err = 0;
+    phase_err = 0;
+    for (int i = 0; i < count; i++) {
+        mag_err = std::max(mag_err, fabsf(expected[i] - actual[i]) / std::max(max_mag, 1e-6f));
+        if (expected[i] > max_mag * 1e-2f) {
+            float diff = remainderf(expected[count + i] - actual[count + i], 2.0f * (float)PI);
+            phase_err = std::max(phase_err, fabsf(diff));
+        }
+    }
+    return mag_err < HAR_MAG_TOLERANCE && phase_err < HAR_PHASE_TOLERANCE;
+}
+
+std::vector<float> KokoroHar::make_test_f0(int f0_len) {
+    std::vector<float> f0(f0_len);
+    for (int i = 0; i < f0_len; i++) {
+        if (i < f0_len / 8) {
+            f0[i] = 0.0f;
+        } else if (i < f0_len / 4) {
+            f0[i] = (i % 2) ? VOICED_THRESHOLD - 0.1f : VOICED_THRESHOLD + 0.1f;
+        } else {
+            f0[i] = 180.0f + 80.0f * sinf(i * 0.05f) + (i % 7) * 3.0f;
+        }
+    }
+    return f0;
+}
@@ -0,0 +1,59 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define HAR_MAG_TOLERANCE       1e-3f   // 与 onnx 模型对比时幅度允许的相对误差 (相对最大幅度)
+#define HAR_PHASE_TOLERANCE     1e-2f   // 幅度足够大的 bin 上允许的相位误差, 弧度
+
+// Kokoro iSTFTNet 的谐波激励 (SourceModuleHnNSF + TorchSTFT), 对应 model4_har_sim.onnx:
+//   f0 最近邻上采样 -> SineGen(harmonic_num=8) -> Linear(9, 1) + tanh -> STFT 幅度/相位
+// 与导出的 sim 模型一致, 不加随机初始相位和噪声
+// Linear 的权重由 scripts/export_har_weights.py 从 onnx 导出到 har_weights.bin
+class KokoroHar {
+public:
+    KokoroHar(int sample_rate, int n_fft, int hop_length);
+
+    // har_weights.bin: float32 [harmonic_num + 1] 个权重, 后跟 1 个 bias
+    bool load(const std::string& weights_path);
+    bool loaded() const { return !weights_.empty(); }
+
+    // f0: [f0_len]
+    // har: [2 * (n_fft/2 + 1), num_frames], 前半为幅度, 后半为相位
+    // 上采样倍数由 (num_frames - 1) * hop / f0_len 得到, 不是整数时返回 false
+    bool run(const float* f0, int f0_len, float* har, int num_frames);
+
+    // 与参考输出 (如 onnx 模型的结果) 对比, 返回是否在容差内
+    // mag_err: 幅度的最大相对误差, phase_err: 幅度明显非零的 bin 上相位的最大误差
+    bool compare(const float* expected, const float* actual, int num_frames, float& mag_err, float& phase_err) const;
+
+    // 对比用的 F0: 清音、阈值附近和连续变化的浊音都覆盖到
+    static std::vector<float> make_test_f0(int f0_len);
+
+private:
+    void sine_merge_(const float* f0, int f0_len, int upsample);
+    void stft_(float* har, int num_frames);
+
+    int sample_rate_;
+    int n_fft_;
+    int n_freq_;
+    int hop_;
+
+    std::vector<float> weights_;
+    float bias_ = 0.0f;
+
+    std::vector<float> window_cos_;     // [n_freq, n_fft], 含 hann 窗
+    std::vector<float> window_sin_;     // [n_freq, n_fft]
+
+    std::vector<float> phase_;          // [f0_len], 单个谐波的低采样率相位
+    std::vector<float> source_;         // [n_fft/2 + f0_len * upsample + n_fft/2], 两端反射补齐
+};
@@ -11,53 +11,119 @@
 
 #include <memory>
 #include <map>
+#include <atomic>
 
 #include "utils/text_cleaner.hpp"
 #include "utils/text_normalizer.hpp"
 #include "utils/g2p/g2p.hpp"
 #include "utils/g2p/EnEspeakG2P.hpp"
+#include "utils/g2p/EspeakWorkerPool.hpp"
 #include "utils/logger.h"
 #include "utils/string_utils.hpp"
+#include "tts/tts_stats.hpp"
 
 #define TTS_FRONTEND_MAX_LEN    64
 
 typedef struct {
     char espeak_data_path[TTS_FRONTEND_MAX_LEN];
+    int num_g2p_workers;    // espeak 子进程数, 0 时在本进程内串行运行
+    int g2p_cache_words;    // 非 0 时按词缓存 espeak 的输出, 见 EspeakG2P::set_cache_words
 
 } TTSFrontendConfig;
 
 class TTSFrontend {
 public:
     TTSFrontend():
-        inited_(false) {
+        inited_(false),
+        g2p_cache_(nullptr),
+        cache_hits_base_(0),
+        cache_misses_base_(0) {
 
     }
     ~TTSFrontend() = default;
 
     bool init(const TTSFrontendConfig& config) {
-        g2p_ = std::make_unique<utils::EnEspeakG2P>();
+        // 先 fork worker, 子进程各自 espeak_Initialize, 不继承本进程的 espeak 状态
+        // worker 失败时仍可以在本进程内运行, 不算初始化失败
+        if (!g2p_pool_.start(config.num_g2p_workers, config.espeak_data_path, 
+                             utils::EnEspeakG2P::espeak_language(false), config.g2p_cache_words != 0)) {
+            ALOGW("Start g2p workers failed, run espeak in this process");
+        }
+
+        auto g2p = std::make_unique<utils::EnEspeakG2P>(config.espeak_data_path);
+        g2p->set_cache_words(config.g2p_cache_words != 0);
+        g2p_cache_ = &g2p->get_cache();
+        g2p_ = std::move(g2p);
         inited_ = true;
         return true;
     }
 
-    std::vector<int> run(const std::string& input_text, const std::map<std::string, int>& vocab, int& err) {
+    // stats 不为空时记录各步骤的耗时, tag 标出所属请求
+    // 可以在多个线程同时调用, 没有 g2p worker 时未命中音素缓存的 espeak 调用串行
+    std::vector<int> run(const std::string& input_text, const std::map<std::string, int>& vocab, int& err, 
+                         TTSStats* stats = nullptr, const TraceTag& tag = TraceTag()) {
         if (!inited_) {
             ALOGE("frontend is not inited, call init first!");
             err = -1;
             return std::vector<int>{};
         }
 
-        auto cleaned_text = cleaner_.run(input_text);
-        auto normalized_text = normalizer_.run(cleaned_text);
-        auto phonemes = g2p_->run(normalized_text, err);
+        std::string cleaned_text, normalized_text, phonemes;
+        {
+            ScopedStageTimer timer(stats, AX_TTS_STAGE_CLEAN, tag);
+            cleaned_text = cleaner_.run(input_text);
+        }
+        {
+            ScopedStageTimer timer(stats, AX_TTS_STAGE_NORMALIZE, tag);
+            normalized_text = normalizer_.run(cleaned_text);
+        }
+        {
+            ScopedStageTimer timer(stats, AX_TTS_STAGE_G2P, tag);
+            phonemes = run_g2p_(normalized_text, err);
+        }
 
         ALOGD("input_text: %s", input_text.c_str());
         ALOGD("cleaned_text: %s", cleaned_text.c_str());
         ALOGD("normalized_text: %s", normalized_text.c_str());
         ALOGD("phonemes: %s", phonemes.c_str());
 
+        return tokenize(phonemes, vocab, stats, tag);
+    }
+
+    // 还在运行的 g2p worker 数, 少于配置的数量说明有 worker 异常退出了
+    int num_g2p_workers() {
+        return g2p_pool_.size();
+    }
+
+    // 音素缓存的命中和未命中次数, 包括 worker 进程中的缓存. reset 只清零计数, 不清空缓存
+    void get_g2p_cache_stats(uint64_t& hits, uint64_t& misses, bool reset) {
+        hits = 0;
+        misses = 0;
+        if (!inited_) {
+            return;
+        }
+
+        g2p_pool_.cache_stats(hits, misses);
+        hits += g2p_cache_->hits();
+        misses += g2p_cache_->misses();
+
+        uint64_t hits_base = cache_hits_base_.load(std::memory_order_relaxed);
+        uint64_t misses_base = cache_misses_base_.load(std::memory_order_relaxed);
+        if (reset) {
+            cache_hits_base_.store(hits, std::memory_order_relaxed);
+            cache_misses_base_.store(misses, std::memory_order_relaxed);
+        }
+        hits -= hits_base;
+        misses -= misses_base;
+    }
+
+    // 音素串 -> token id, 首尾补 0. 不在词表中的字符丢弃
+    // 只读 vocab, 不需要 espeak, 可以在多个线程同时调用
+    static std::vector<int> tokenize(const std::string& phonemes, const std::map<std::string, int>& vocab, 
+                                     TTSStats* stats = nullptr, const TraceTag& tag = TraceTag()) {
+        ScopedStageTimer timer(stats, AX_TTS_STAGE_TOKENIZE, tag);
         std::vector<int> tokens;
-        tokens.reserve(input_text.length() * 2);
+        tokens.reserve(phonemes.length() + 2);
         tokens.emplace_back(0);
 
         std::vector<std::string> chars = utils::split_utf8(phonemes);
@@ -72,9 +138,25 @@ public:
         return tokens;
     }
 
+private:
+    std::string run_g2p_(const std::string& text, int& err) {
+        std::string phonemes;
+        if (g2p_pool_.run(text, phonemes, err)) {
+            return phonemes;
+        }
+
+        // 没有 worker 或文本超出共享缓冲, 在本进程内运行
+        // EspeakG2P 自己持有 espeak 的锁, 命中音素缓存的段不需要等待
+        return g2p_->run(text, err);
+    }
+
 private:
     bool inited_;
     utils::TextCleaner cleaner_;
     utils::TextNormalizer normalizer_;
     std::unique_ptr<utils::G2P> g2p_;
+    utils::PhonemeCache* g2p_cache_;        // g2p_ 的音素缓存
+    utils::EspeakWorkerPool g2p_pool_;
+    std::atomic<uint64_t> cache_hits_base_;     // 上次 reset 时的计数
+    std::atomic<uint64_t> cache_misses_base_;
 };
\ No newline at end of file
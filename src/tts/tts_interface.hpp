@@ -11,12 +11,29 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 #include "api/ax_tts_api.h"
 
+// Called once for every text of run_batch(), audio is NULL if the text failed
+// and otherwise owned by the handler (free() it)
+typedef std::function<void(size_t index, AX_TTS_AUDIO* audio)> BatchDoneHandler;
+
 class TTSInterface {
 public:
     virtual ~TTSInterface() {}
     virtual bool init(AX_TTS_TYPE_E tts_type, AX_TTS_INIT_CONFIG* init_config) = 0;
     virtual void uninit(void) = 0;
     virtual bool run(const std::string& text, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) = 0;
+    virtual bool run_phonemes(const std::string& phonemes, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) = 0;
+    virtual bool run_tokens(const std::vector<int>& tokens, AX_TTS_RUN_CONFIG* run_config, AX_TTS_AUDIO** audio) = 0;
+    virtual bool run_into(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                          void* buffer, int buffer_len, int* num_samples) = 0;
+    virtual bool run_stream(const std::string& text, AX_TTS_RUN_CONFIG* run_config, 
+                            AX_TTS_STREAM_CALLBACK callback, void* user_data) = 0;
+    virtual bool run_batch(const std::vector<std::string>& texts, AX_TTS_RUN_CONFIG* run_config, 
+                           const BatchDoneHandler& on_done) = 0;
+    virtual bool warmup(const std::vector<std::string>& voices) = 0;
+    virtual void get_stats(AX_TTS_STATS* stats, bool reset) = 0;
+    virtual bool start_trace(const std::string& path) = 0;
+    virtual bool stop_trace() = 0;
 };
\ No newline at end of file
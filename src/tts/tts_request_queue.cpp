@@ -0,0 +1,199 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "tts/tts_request_queue.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/logger.h"
+
+#define MAX_GROUP_SIZE  4   // 一个工作线程一次最多取几个请求
+
+TTSRequestQueue::TTSRequestQueue(TTSInterface* tts, int num_workers):
+    tts_(tts),
+    num_workers_(num_workers) {
+    for (int i = 0; i < num_workers; i++) {
+        workers_.emplace_back(&TTSRequestQueue::worker_loop_, this);
+    }
+}
+
+TTSRequestQueue::~TTSRequestQueue() {
+    stop();
+
+    for (auto& it : requests_) {
+        free(it.second->audio);
+    }
+    requests_.clear();
+}
+
+void TTSRequestQueue::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_) {
+        return;
+    }
+    stop_ = true;
+    if (!pending_.empty()) {
+        ALOGW("Drop %d pending requests", (int)pending_.size());
+    }
+    for (auto& request : pending_) {
+        request->cancelled = true;
+        request->done = true;
+    }
+    pending_.clear();
+    lock.unlock();
+
+    queue_cv_.notify_all();
+    // 等待被丢弃请求的线程立即返回
+    done_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    // 正在合成的请求已经结束, 等待它们的线程也都会返回
+    lock.lock();
+    done_cv_.wait(lock, [this]() { return num_waiters_ == 0; });
+}
+
+AX_TTS_REQUEST_ID TTSRequestQueue::submit(const std::string& text, const AX_TTS_RUN_CONFIG& run_config) {
+    auto request = std::make_shared<Request>();
+    request->text = text;
+    request->run_config = run_config;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) {
+            ALOGE("Request queue is stopped!");
+            return -1;
+        }
+        request->id = next_id_++;
+        requests_[request->id] = request;
+        pending_.push_back(request);
+    }
+    queue_cv_.notify_one();
+
+    return request->id;
+}
+
+int TTSRequestQueue::wait(AX_TTS_REQUEST_ID request_id, AX_TTS_AUDIO** audio, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = requests_.find(request_id);
+    if (it == requests_.end()) {
+        ALOGE("Unknown request id %lld", (long long)request_id);
+        return AX_TTS_ERR_INVALID_REQUEST;
+    }
+
+    // 等待期间 requests_ 可能被其它调用者修改, 持有 shared_ptr 而不是迭代器
+    std::shared_ptr<Request> request = it->second;
+    auto is_done = [&request]() { return request->done; };
+    bool done = true;
+    num_waiters_++;
+    if (timeout_ms < 0) {
+        done_cv_.wait(lock, is_done);
+    } else {
+        done = done_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), is_done);
+    }
+    num_waiters_--;
+    if (stop_) {
+        // stop 在等所有等待者返回, 持有锁时通知, 之后不再访问成员
+        done_cv_.notify_all();
+    }
+    if (!done) {
+        return AX_TTS_ERR_NOT_READY;
+    }
+
+    // 另一个线程已经取走了结果
+    if (!requests_.erase(request_id)) {
+        ALOGE("Request %lld has been taken", (long long)request_id);
+        return AX_TTS_ERR_INVALID_REQUEST;
+    }
+
+    if (request->cancelled) {
+        return AX_TTS_ERR_CANCELLED;
+    }
+    if (!request->ok) {
+        return -1;
+    }
+
+    *audio = request->audio;
+    request->audio = nullptr;
+    return 0;
+}
+
+void TTSRequestQueue::worker_loop_() {
+    std::vector<std::shared_ptr<Request>> group;
+    std::vector<std::string> texts;
+    while (true) {
+        group.clear();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+            if (stop_) {
+                break;
+            }
+
+            // 排队的请求平均分给各工作线程, 不够分时一次只取一个
+            size_t max_group = std::min<size_t>(MAX_GROUP_SIZE, std::max<size_t>(1, pending_.size() / num_workers_));
+            group.push_back(pending_.front());
+            pending_.pop_front();
+            for (auto it = pending_.begin(); it != pending_.end() && group.size() < max_group; ) {
+                if (same_config_((*it)->run_config, group[0]->run_config)) {
+                    group.push_back(*it);
+                    it = pending_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        if (group.size() == 1) {
+            Request& request = *group[0];
+            AX_TTS_AUDIO* audio = nullptr;
+            if (!tts_->run(request.text, &request.run_config, &audio)) {
+                free(audio);
+                audio = nullptr;
+            }
+            finish_(request, audio);
+            continue;
+        }
+
+        texts.clear();
+        for (auto& request : group) {
+            texts.push_back(request->text);
+        }
+        // 每个请求完成时就通知, 不等同组的其它请求
+        tts_->run_batch(texts, &group[0]->run_config, [this, &group](size_t index, AX_TTS_AUDIO* audio) {
+            finish_(*group[index], audio);
+        });
+    }
+}
+
+void TTSRequestQueue::finish_(Request& request, AX_TTS_AUDIO* audio) {
+    if (!audio) {
+        ALOGE("Run request %lld failed!", (long long)request.id);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        request.ok = (audio != nullptr);
+        request.audio = audio;
+        request.done = true;
+    }
+    done_cv_.notify_all();
+}
+
+bool TTSRequestQueue::same_config_(const AX_TTS_RUN_CONFIG& a, const AX_TTS_RUN_CONFIG& b) {
+    return a.speed == b.speed && a.fade_out == b.fade_out && a.sample_rate == b.sample_rate && 
+           a.sample_format == b.sample_format && a.pack_texts == b.pack_texts && 
+           strncmp(a.voice, b.voice, AX_TTS_MAX_STR_LEN) == 0 && 
+           strncmp(a.language, b.language, AX_TTS_MAX_STR_LEN) == 0;
+}
@@ -0,0 +1,73 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "tts/tts_interface.hpp"
+
+// AX_TTS_Submit 的请求队列: 调用者只入队, 由内部的工作线程调用 tts->run
+// 工作线程数与执行上下文数相同, 多个请求在 NPU 和 CPU 上交错执行
+// 排队的请求多于工作线程时, 配置相同的几个请求一起交给 run_batch, 短文本可以拼进同一次推理
+class TTSRequestQueue {
+public:
+    TTSRequestQueue(TTSInterface* tts, int num_workers);
+    // stop 之后释放未取走的结果
+    ~TTSRequestQueue();
+
+    // 还没开始的请求以 AX_TTS_ERR_CANCELLED 结束, 等正在合成的请求结束,
+    // 再等已经阻塞在 wait 中的线程都返回. 之后 submit 失败
+    void stop();
+
+    TTSRequestQueue(const TTSRequestQueue&) = delete;
+    TTSRequestQueue& operator=(const TTSRequestQueue&) = delete;
+
+    // 返回请求 id (> 0), stop 之后返回 -1
+    AX_TTS_REQUEST_ID submit(const std::string& text, const AX_TTS_RUN_CONFIG& run_config);
+
+    // timeout_ms = 0 时立即返回, < 0 时一直等
+    // 返回 0 时 *audio 交给调用者, 请求结束; AX_TTS_ERR_NOT_READY 表示还在排队或合成;
+    // 合成失败返回 -1, 被 stop 丢弃返回 AX_TTS_ERR_CANCELLED, 请求同样结束
+    int wait(AX_TTS_REQUEST_ID request_id, AX_TTS_AUDIO** audio, int timeout_ms);
+
+private:
+    struct Request {
+        AX_TTS_REQUEST_ID id;
+        std::string text;
+        AX_TTS_RUN_CONFIG run_config;
+        bool done = false;
+        bool ok = false;
+        bool cancelled = false;     // 还没开始就被 stop 丢弃
+        AX_TTS_AUDIO* audio = nullptr;
+    };
+
+    void worker_loop_();
+    void finish_(Request& request, AX_TTS_AUDIO* audio);
+    static bool same_config_(const AX_TTS_RUN_CONFIG& a, const AX_TTS_RUN_CONFIG& b);
+
+    TTSInterface* tts_;
+    int num_workers_;
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;      // 有新请求或要退出
+    std::condition_variable done_cv_;       // 有请求完成, 或 stop 时有等待者返回
+    std::deque<std::shared_ptr<Request>> pending_;
+    std::map<AX_TTS_REQUEST_ID, std::shared_ptr<Request>> requests_;   // 已提交且结果未取走的请求
+    AX_TTS_REQUEST_ID next_id_ = 1;
+    bool stop_ = false;
+    int num_waiters_ = 0;                   // 阻塞在 wait 中的线程数
+    std::vector<std::thread> workers_;
+};
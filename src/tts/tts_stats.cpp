@@ -0,0 +1,80 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "tts/tts_stats.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+TTSStats::TTSStats() {
+    reset();
+}
+
+const char* TTSStats::stage_name(AX_TTS_STAGE_E stage) {
+    static const char* names[AX_TTS_STAGE_NUM] = {
+        "clean", "normalize", "g2p", "tokenize", "model1", "alignment", 
+        "model2", "har", "model3", "istft", "request",
+    };
+    return (stage >= 0 && stage < AX_TTS_STAGE_NUM) ? names[stage] : "unknown";
+}
+
+void TTSStats::record(AX_TTS_STAGE_E stage, Clock::time_point start, const TraceTag& tag) {
+    auto end = Clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    stages_[stage].record(us > 0 ? (uint64_t)us : 0);
+    trace_.add(stage_name(stage), start, end, tag);
+}
+
+void TTSStats::add_request(bool ok, Clock::time_point start, size_t num_samples, int sample_rate, 
+                           const TraceTag& tag) {
+    record(AX_TTS_STAGE_REQUEST, start, tag);
+    num_requests_.fetch_add(1, std::memory_order_relaxed);
+    if (!ok) {
+        num_failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (sample_rate > 0) {
+        audio_us_.fetch_add(num_samples * 1000000ull / sample_rate, std::memory_order_relaxed);
+    }
+}
+
+void TTSStats::get(AX_TTS_STATS* stats) const {
+    memset(stats, 0, sizeof(AX_TTS_STATS));
+    for (int i = 0; i < AX_TTS_STAGE_NUM; i++) {
+        const utils::LatencyHistogram& hist = stages_[i];
+        AX_TTS_STAGE_STATS& out = stats->stages[i];
+        out.count = hist.count();
+        if (out.count == 0)
+            continue;
+
+        // 桶的中点可能大于实际的最大值
+        double max_us = hist.max();
+        out.mean_ms = hist.sum() / 1000.0 / out.count;
+        out.p50_ms = std::min(hist.percentile(0.50), max_us) / 1000.0;
+        out.p95_ms = std::min(hist.percentile(0.95), max_us) / 1000.0;
+        out.p99_ms = std::min(hist.percentile(0.99), max_us) / 1000.0;
+        out.max_ms = max_us / 1000.0;
+    }
+
+    stats->num_requests = num_requests_.load(std::memory_order_relaxed);
+    stats->num_failed = num_failed_.load(std::memory_order_relaxed);
+    stats->audio_seconds = audio_us_.load(std::memory_order_relaxed) / 1e6;
+    if (stats->audio_seconds > 0) {
+        double request_seconds = stages_[AX_TTS_STAGE_REQUEST].sum() / 1e6;
+        stats->rtf = request_seconds / stats->audio_seconds;
+    }
+}
+
+void TTSStats::reset() {
+    for (auto& hist : stages_) {
+        hist.reset();
+    }
+    num_requests_.store(0, std::memory_order_relaxed);
+    num_failed_.store(0, std::memory_order_relaxed);
+    audio_us_.store(0, std::memory_order_relaxed);
+}
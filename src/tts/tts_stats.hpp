@@ -0,0 +1,66 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "api/ax_tts_api.h"
+#include "utils/latency_histogram.hpp"
+#include "tts/tts_trace.hpp"
+
+// 一个句柄的各阶段耗时和请求计数, 所有执行上下文和后处理线程并发写入, 不加锁
+// 开启追踪时同一份计时也写成追踪事件
+class TTSStats {
+public:
+    typedef TTSTrace::Clock Clock;
+
+    TTSStats();
+
+    void record(AX_TTS_STAGE_E stage, Clock::time_point start, const TraceTag& tag = TraceTag());
+    // 请求结束时调用, num_samples 按 sample_rate 换算成音频时长
+    void add_request(bool ok, Clock::time_point start, size_t num_samples, int sample_rate, 
+                     const TraceTag& tag = TraceTag());
+
+    void get(AX_TTS_STATS* stats) const;
+    void reset();
+
+    TTSTrace& trace() { return trace_; }
+
+    static const char* stage_name(AX_TTS_STAGE_E stage);
+
+private:
+    TTSTrace trace_;
+    utils::LatencyHistogram stages_[AX_TTS_STAGE_NUM];
+    std::atomic<uint64_t> num_requests_;
+    std::atomic<uint64_t> num_failed_;
+    std::atomic<uint64_t> audio_us_;    // 合成音频的总时长, 微秒
+};
+
+// 在作用域结束时记录一个阶段的耗时, stats 为空时不记录
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(TTSStats* stats, AX_TTS_STAGE_E stage, const TraceTag& tag = TraceTag()):
+        stats_(stats), stage_(stage), tag_(tag), start_(TTSStats::Clock::now()) {}
+    ~ScopedStageTimer() {
+        if (stats_)
+            stats_->record(stage_, start_, tag_);
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    TTSStats* stats_;
+    AX_TTS_STAGE_E stage_;
+    TraceTag tag_;
+    TTSStats::Clock::time_point start_;
+};
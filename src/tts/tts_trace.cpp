@@ -0,0 +1,136 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "tts/tts_trace.hpp"
+
+#include <fstream>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "utils/nlohmann/json.hpp"
+#include "utils/logger.h"
+
+#define TRACE_MAX_EVENTS    (1 << 20)   // 超出后丢弃, 避免忘记停止时内存一直增长
+
+bool TTSTrace::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled()) {
+        ALOGE("Trace is already started, writing to %s", path_.c_str());
+        return false;
+    }
+
+    path_ = path;
+    origin_ = Clock::now();
+    events_.clear();
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool TTSTrace::stop() {
+    std::vector<Event> events;
+    Clock::time_point origin;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!enabled()) {
+            ALOGE("Trace is not started!");
+            return false;
+        }
+        enabled_.store(false, std::memory_order_relaxed);
+        events.swap(events_);
+        origin = origin_;
+        path = path_;
+    }
+
+    // 写文件不持有锁
+    return write_(events, origin, path);
+}
+
+void TTSTrace::add(const char* name, Clock::time_point begin, Clock::time_point end,
+                   const TraceTag& tag, const std::vector<TraceTag>& parts) {
+    if (!enabled())
+        return;
+
+    int tid = thread_id_();
+    std::lock_guard<std::mutex> lock(mutex_);
+    // stop 之后才拿到锁的事件不再记录
+    if (!enabled() || events_.size() >= TRACE_MAX_EVENTS)
+        return;
+    events_.push_back(Event{name, begin, end, tid, tag, parts});
+}
+
+int TTSTrace::thread_id_() {
+    // 内核线程号, 与 top/perf 中看到的一致
+    static thread_local int tid = (int)syscall(SYS_gettid);
+    return tid;
+}
+
+static void tag_to_json(const TraceTag& tag, nlohmann::json& args) {
+    if (tag.request >= 0)
+        args["request"] = tag.request;
+    if (tag.chunk >= 0)
+        args["chunk"] = tag.chunk;
+    if (tag.pass >= 0)
+        args["pass"] = tag.pass;
+}
+
+bool TTSTrace::write_(const std::vector<Event>& events, Clock::time_point origin, const std::string& path) {
+    if (events.size() >= TRACE_MAX_EVENTS) {
+        ALOGW("Trace reached %d events, later events are dropped", TRACE_MAX_EVENTS);
+    }
+
+    int pid = (int)getpid();
+    nlohmann::json trace_events = nlohmann::json::array();
+    for (const auto& event : events) {
+        nlohmann::json args = nlohmann::json::object();
+        tag_to_json(event.tag, args);
+        if (!event.parts.empty()) {
+            nlohmann::json parts = nlohmann::json::array();
+            for (const auto& part : event.parts) {
+                nlohmann::json part_args = nlohmann::json::object();
+                tag_to_json(part, part_args);
+                parts.push_back(part_args);
+            }
+            args["parts"] = parts;
+        }
+
+        // 完整事件 (ph = X), 时间单位微秒
+        double ts = std::chrono::duration<double, std::micro>(event.begin - origin).count();
+        double dur = std::chrono::duration<double, std::micro>(event.end - event.begin).count();
+        trace_events.push_back({
+            {"name", event.name},
+            {"cat", "tts"},
+            {"ph", "X"},
+            {"ts", ts},
+            {"dur", dur},
+            {"pid", pid},
+            {"tid", event.tid},
+            {"args", args},
+        });
+    }
+
+    nlohmann::json trace = {
+        {"traceEvents", trace_events},
+        {"displayTimeUnit", "ms"},
+    };
+
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        ALOGE("Open trace file %s failed!", path.c_str());
+        return false;
+    }
+    ofs << trace.dump();
+    if (!ofs.good()) {
+        ALOGE("Write trace file %s failed!", path.c_str());
+        return false;
+    }
+
+    ALOGI("Wrote %d trace events to %s", (int)events.size(), path.c_str());
+    return true;
+}
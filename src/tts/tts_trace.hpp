@@ -0,0 +1,63 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 追踪事件关联的请求/块/推理批次, -1 表示无关
+struct TraceTag {
+    int64_t request = -1;
+    int chunk = -1;
+    int64_t pass = -1;
+};
+
+// 按需开启的事件追踪, 停止时写成 Chrome trace event 格式的 JSON,
+// 可以用 chrome://tracing 或 ui.perfetto.dev 打开, 按线程查看 CPU 与 NPU 阶段的重叠和空闲
+// 未开启时 add 只读一次原子变量
+class TTSTrace {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // 清空之前的事件, 开始记录. 已经在记录时返回 false
+    bool start(const std::string& path);
+    // 停止记录并写文件
+    bool stop();
+
+    bool enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // parts: 一次推理拼接的各请求的块
+    void add(const char* name, Clock::time_point begin, Clock::time_point end,
+             const TraceTag& tag, const std::vector<TraceTag>& parts = std::vector<TraceTag>());
+
+private:
+    struct Event {
+        const char* name;
+        Clock::time_point begin, end;
+        int tid;
+        TraceTag tag;
+        std::vector<TraceTag> parts;
+    };
+
+    static int thread_id_();
+    bool write_(const std::vector<Event>& events, Clock::time_point origin, const std::string& path);
+
+    std::atomic<bool> enabled_{false};
+    std::mutex mutex_;
+    std::string path_;
+    Clock::time_point origin_;
+    std::vector<Event> events_;
+};
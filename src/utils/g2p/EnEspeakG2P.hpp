@@ -19,21 +19,26 @@ class EnEspeakG2P : public G2P {
 public:
     EnEspeakG2P(const char* espeak_data_path = "./espeak-ng-data", bool british = false):
         espeak_(espeak_data_path),
-        british_(british) {
-            if (british) {
-                language_ = "en-gb";
-            } else {
-                language_ = "en-us";
-            }
+        british_(british),
+        language_(espeak_language(british)) {
     }
 
     ~EnEspeakG2P() = default;
+
+    // 不创建实例也能知道 espeak 的语言, 如 fork g2p worker 时
+    static std::string espeak_language(bool british) {
+        return british ? "en-gb" : "en-us";
+    }
     
     std::string get_language() const override { 
         return language_; 
     }
 
     std::string get_backend() const override { return "espeak"; }
+
+    // 按段(或按词)缓存的 espeak 输出, 可以查看命中率或调整容量
+    inline PhonemeCache& get_cache() { return espeak_.get_cache(); }
+    inline void set_cache_words(bool words) { espeak_.set_cache_words(words); }
     
     std::string run(const std::string& input_text, int& err) {
         std::string result = espeak_.run(input_text, get_language(), err);
@@ -8,68 +8,67 @@
  *
  **************************************************************************************************/
 #include "utils/g2p/EspeakG2P.hpp"
+
+#include <ctype.h>
+
 #include "utils/logger.h"
 
 namespace utils {
 
 thread_local int32_t EspeakG2P::instance_counter_ = 0;
 std::mutex EspeakG2P::global_espeak_mutex_;
-E2M_Type EspeakG2P::E2M_ = {
-    { R"(ʔˌn\u0329)", "tn" }, 
-    { R"(ʔn\u0329)", "tn" }, 
-    { R"(ʔn)", "tn" }, 
-    { R"(ʔ)", "t" }, 
-    { R"(aɪ)", "I" }, 
-    { R"(aʊ)", "W" }, 
-    { R"(dʒ)", "ʤ" }, 
-    { R"(eɪ)", "A" }, 
-    { R"(e)", "A" }, 
-    { R"(tʃ)", "ʧ" }, 
-    { R"(ɔɪ)", "Y" }, 
-    { R"(əl)", "ᵊl" }, 
-    { R"(ʲo)", "jo" }, 
-    { R"(ʲə)", "jə" }, 
-    { R"(ʲ)", "" }, 
-    { R"(ɚ)", "əɹ" }, 
-    { R"(r)", "ɹ" }, 
-    { R"(x)", "k" }, 
-    { R"(ç)", "k" }, 
-    { R"(ɐ)", "ə" }, 
-    { R"(ɬ)", "l" }, 
-    { R"(\u0303)", "" }, 
-    { R"(oʊ)", "O" }, 
-    { R"(ɜːɹ)", "ɜɹ" }, 
-    { R"(ɜː)", "ɜɹ" }, 
-    { R"(ɪə)", "iə" }, 
-    { R"(ː)", "" } 
+// misaki 中是按顺序逐条替换, 前面替换的结果还会被后面的规则匹配, 这里整理成一次遍历的等价规则:
+// 1. 被前面规则覆盖的不再列出: eɪ (e 先替换), ɜːɹ (ɜː 先替换), ʔn / ʔˌn\u0329 (ʔ 先替换), ʲo / ʲə (ʲ 先删除)
+// 2. ɐ -> ə 和 ɚ -> əɹ 的结果会再被 əl, ɪə 替换, 以及 əl 先于 ɪə 替换, 合并成 ɐl, ɪɐ, ɪɚ, ɪəl, ɪɐl
+// 3. 最后删除分隔符 _
+const RewriteRules EspeakG2P::E2M_RULES_ = {
+    { "aɪ", "I" }, 
+    { "aʊ", "W" }, 
+    { "dʒ", "ʤ" }, 
+    { "e", "A" }, 
+    { "oʊ", "O" }, 
+    { "r", "ɹ" }, 
+    { "tʃ", "ʧ" }, 
+    { "x", "k" }, 
+    { "ç", "k" }, 
+    { "ɐ", "ə" }, 
+    { "ɐl", "ᵊl" }, 
+    { "ɔɪ", "Y" }, 
+    { "əl", "ᵊl" }, 
+    { "ɚ", "əɹ" }, 
+    { "ɜː", "ɜɹ" }, 
+    { "ɪə", "iə" }, 
+    { "ɪəl", "ɪᵊl" }, 
+    { "ɪɐ", "iə" }, 
+    { "ɪɐl", "ɪᵊl" }, 
+    { "ɪɚ", "iəɹ" }, 
+    { "ɬ", "l" }, 
+    { "ʔ", "t" }, 
+    { "ʲ", "" }, 
+    { "ː", "" }, 
+    { "\u0303", "" }, 
+    { "_", "" } 
 };
+const PhonemeRewriter EspeakG2P::E2M_(E2M_RULES_);
 
 std::string EspeakG2P::run(const std::string& input_text, const std::string& language, int& err) {
-    std::lock_guard<std::mutex> lock(global_espeak_mutex_);
-
-    voice_properties_.languages = language.c_str();
-    err = espeak_SetVoiceByProperties(&voice_properties_);
-    if (err != EE_OK) {
-        ALOGE("espeak_SetVoiceByProperties failed! language is %s", language.c_str());
-        return std::string("");
-    }
-
-    // 0x02 means IPA, ('_' << 8) means using _ as seperator
-    int phonememode = 0x02 | ('_' << 8);
-    
+    err = 0;
     std::string phonemes;
     phonemes.reserve(input_text.length() * 2);
 
     // 分割标点
     auto line_marks = _phonemize_preprocess(input_text);
 
+    // espeak 使用全局状态, 第一次未命中缓存时才加锁, 之后的段不再重复设置语音
+    std::unique_lock<std::mutex> espeak_lock(global_espeak_mutex_, std::defer_lock);
     for (size_t i = 0; i < line_marks.size(); i++) {
-        const char* text_ptr = line_marks[i].first.c_str();
-
-        while (text_ptr != NULL) {
-            const char* out_ptr = espeak_TextToPhonemes(
-                reinterpret_cast<const void **>(&text_ptr), espeakCHARS_AUTO, phonememode);
-            phonemes.append(out_ptr);
+        if (cache_words_) {
+            phonemes.append(_phonemize_words(line_marks[i].first, language, espeak_lock, err));
+        } else {
+            phonemes.append(_phonemize_segment(line_marks[i].first, language, espeak_lock, err));
+        }
+        if (err != EE_OK) {
+            return std::string("");
         }
 
         // 添加回标点
@@ -80,6 +79,9 @@ std::string EspeakG2P::run(const std::string& input_text, const std::string& lan
             phonemes.append(std::string(" "));
         }
     }
+    if (espeak_lock.owns_lock()) {
+        espeak_lock.unlock();
+    }
 
     // 后处理, 替换部分音素使其更自然
     _phonemize_postprocess(phonemes);
@@ -87,4 +89,88 @@ std::string EspeakG2P::run(const std::string& input_text, const std::string& lan
     return phonemes;
 }
 
+std::string EspeakG2P::_phonemize_segment(const std::string& text, const std::string& language, 
+                                          std::unique_lock<std::mutex>& espeak_lock, int& err) {
+    // espeak 对每一段单独转换, 结果只取决于语言和这一段的文本
+    std::string key;
+    key.reserve(language.size() + 1 + text.size());
+    key.append(language);
+    key.push_back('\0');
+    key.append(text);
+
+    std::string phonemes;
+    if (cache_.get(key, phonemes)) {
+        return phonemes;
+    }
+
+    if (!espeak_lock.owns_lock()) {
+        espeak_lock.lock();
+        voice_properties_.languages = language.c_str();
+        err = espeak_SetVoiceByProperties(&voice_properties_);
+        if (err != EE_OK) {
+            ALOGE("espeak_SetVoiceByProperties failed! language is %s", language.c_str());
+            return std::string("");
+        }
+    }
+
+    // 0x02 means IPA, ('_' << 8) means using _ as seperator
+    int phonememode = 0x02 | ('_' << 8);
+
+    const char* text_ptr = text.c_str();
+    while (text_ptr != NULL) {
+        const char* out_ptr = espeak_TextToPhonemes(
+            reinterpret_cast<const void **>(&text_ptr), espeakCHARS_AUTO, phonememode);
+        phonemes.append(out_ptr);
+    }
+
+    cache_.put(key, phonemes);
+    return phonemes;
+}
+
+// 按词缓存的键: 去掉首尾的 ASCII 标点(引号, 括号等 Punctuator 不切分的符号), 转成小写
+// 非 ASCII 的字节不变, 不会破坏 UTF-8
+static std::string normalize_word(const std::string& word) {
+    size_t begin = 0, end = word.size();
+    while (begin < end && isascii((unsigned char)word[begin]) && ispunct((unsigned char)word[begin])) {
+        begin++;
+    }
+    while (end > begin && isascii((unsigned char)word[end - 1]) && ispunct((unsigned char)word[end - 1])) {
+        end--;
+    }
+
+    std::string normalized(word, begin, end - begin);
+    for (char& c : normalized) {
+        if (c >= 'A' && c <= 'Z') {
+            c = c - 'A' + 'a';
+        }
+    }
+    return normalized;
+}
+
+std::string EspeakG2P::_phonemize_words(const std::string& text, const std::string& language, 
+                                        std::unique_lock<std::mutex>& espeak_lock, int& err) {
+    std::string phonemes;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find(' ', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+
+        // 跳过连续的空格和只有标点的词. espeak 转换的也是规范化后的词, 缓存的结果与键一致
+        std::string word = normalize_word(text.substr(begin, end - begin));
+        if (!word.empty()) {
+            if (!phonemes.empty()) {
+                phonemes.push_back(' ');
+            }
+            phonemes.append(_phonemize_segment(word, language, espeak_lock, err));
+            if (err != EE_OK) {
+                return std::string("");
+            }
+        }
+        begin = end + 1;
+    }
+    return phonemes;
+}
+
 } // namespace utils
\ No newline at end of file
@@ -9,16 +9,19 @@
  **************************************************************************************************/
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <mutex>
 #include <string.h>
 #include "espeak-ng/speak_lib.h"
 #include "utils/g2p/Punctuator.hpp"
+#include "utils/g2p/PhonemeRewriter.hpp"
+#include "utils/g2p/PhonemeCache.hpp"
 #include "utils/string_utils.hpp"
 
-namespace utils {
+#define ESPEAK_CACHE_CAPACITY   (1 << 20)   // 默认的音素缓存上限, 字节
 
-typedef std::map<std::string, std::string>    E2M_Type;
+namespace utils {
 
 // Following https://github.com/hexgrad/misaki/blob/main/misaki/espeak.py
 class EspeakG2P {
@@ -28,7 +31,9 @@ private:
     // 线程安全锁
     static std::mutex global_espeak_mutex_;
     // misaki中默认要替换的因素, E2M means eSpeak to Misaki
-    static E2M_Type E2M_;
+    static const RewriteRules E2M_RULES_;
+    // 由 E2M_RULES_ 构建, 所有实例共用
+    static const PhonemeRewriter E2M_;
 
     // 语音属性（每个实例独立）
     espeak_VOICE voice_properties_;
@@ -36,10 +41,16 @@ private:
     std::string tie_;
     // 标点分割器
     Punctuator punc_;
+    // 按标点分割后的每一段(或每个词)的 espeak 输出, 命中时不需要 espeak 的锁
+    PhonemeCache cache_;
+    // 按词而不是按段缓存
+    bool cache_words_;
     
 public:
     EspeakG2P(const char* espeak_data_path = "./espeak-ng-data"):
-        tie_("^")
+        tie_("^"),
+        cache_(ESPEAK_CACHE_CAPACITY),
+        cache_words_(false)
     {
         if (instance_counter_ == 0) {
             espeak_Initialize(AUDIO_OUTPUT_RETRIEVAL, 0, espeak_data_path, 0);
@@ -60,7 +71,34 @@ public:
 
     inline void set_tie(const std::string& tie) { tie_ = tie; }
 
+    // 容量为 0 时关闭缓存
+    inline void set_cache_capacity(size_t capacity) { cache_.set_capacity(capacity); }
+    inline PhonemeCache& get_cache() { return cache_; }
+
+    // 按词缓存: 每段按空格切分, 每个词去掉首尾标点并转成小写后单独调用 espeak, 重复的词都能命中缓存
+    // espeak 看不到上下文, 虚词弱读, 句重音和全大写的缩写可能与整段转换不同
+    // 默认按段缓存, 结果与不缓存一致
+    inline void set_cache_words(bool words) { cache_words_ = words; }
+
+    // 原来的正则把 \u0303 截断成了 0x03, 并且按键排序在所有规则之前执行
+    // 先删掉 0x03 再做 E2M 替换, 结果与原来一致. 鼻化符号 U+0303 由 E2M_RULES_ 按 misaki 删除
+    static std::string apply_e2m(std::string phonemes) {
+        phonemes.erase(std::remove(phonemes.begin(), phonemes.end(), '\x03'), phonemes.end());
+        return E2M_.run(phonemes);
+    }
+
+    // 所有实例共用的 espeak 锁, fork 时要持有它
+    static std::mutex& get_global_mutex() { return global_espeak_mutex_; }
+
 protected:
+    // 一段不含标点的文本的 espeak 输出, 未命中缓存时才加锁调用 espeak
+    std::string _phonemize_segment(const std::string& text, const std::string& language, 
+                                   std::unique_lock<std::mutex>& espeak_lock, int& err);
+
+    // 按空格切分, 规范化后逐词调用 _phonemize_segment, 词之间用空格连接
+    std::string _phonemize_words(const std::string& text, const std::string& language, 
+                                 std::unique_lock<std::mutex>& espeak_lock, int& err);
+
     virtual std::vector<LineMarkPair> _phonemize_preprocess(const std::string& text) {
         auto line_marks = punc_.run(text);
 
@@ -78,11 +116,8 @@ protected:
     }
 
     virtual std::string _phonemize_postprocess(std::string& phonemes) {
-        // replace phonemes in E2M
-        for (auto& [key, value]: E2M_) {
-            phonemes = std::regex_replace(phonemes, std::regex(key), value);
-        }
-        phonemes = std::regex_replace(phonemes, std::regex(R"(_)"), "");
+        // replace phonemes in E2M, and remove separator '_'
+        phonemes = apply_e2m(std::move(phonemes));
         return phonemes;
     }
 };
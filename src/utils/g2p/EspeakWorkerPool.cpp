@@ -0,0 +1,309 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "utils/g2p/EspeakWorkerPool.hpp"
+
+#include <new>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "utils/g2p/EspeakG2P.hpp"
+#include "utils/logger.h"
+
+namespace utils {
+
+// 放在 fork 之前 mmap 的共享内存里, 主进程和 worker 看到的是同一份
+// 一个 worker 同一时刻只处理一个请求, 请求和结果共用 data
+struct EspeakWorkerPool::Channel {
+    sem_t request;          // 主进程写好文本后 post
+    sem_t response;         // worker 写好音素后 post
+    int32_t quit;
+    int32_t err;
+    int32_t overflow;       // 音素超出缓冲, 结果无效
+    uint64_t cache_hits;    // worker 中音素缓存的累计计数, 随每个结果一起写回
+    uint64_t cache_misses;
+    uint32_t size;
+    char data[G2P_WORKER_BUF_SIZE];
+};
+
+// 等待一个轮询间隔, 超时返回 false 并把 errno 设为 ETIMEDOUT
+static bool timed_wait(sem_t* sem) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += G2P_WORKER_POLL_MS / 1000;
+    deadline.tv_nsec += (G2P_WORKER_POLL_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return sem_timedwait(sem, &deadline) == 0;
+}
+
+bool EspeakWorkerPool::start(int num_workers, const std::string& espeak_data_path, const std::string& language, 
+                             bool cache_words) {
+    if (shm_) {
+        ALOGE("G2P workers are already started!");
+        return false;
+    }
+    if (num_workers <= 0) {
+        return true;
+    }
+
+    espeak_data_path_ = espeak_data_path;
+    language_ = language;
+    cache_words_ = cache_words;
+
+    shm_size_ = sizeof(Channel) * num_workers;
+    void* shm = mmap(NULL, shm_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        ALOGE("mmap %d bytes for g2p workers failed! %s", (int)shm_size_, strerror(errno));
+        return false;
+    }
+    shm_ = shm;
+
+    // free_workers_ 保存指针, workers_ 之后不能再扩容
+    workers_.reserve(num_workers);
+    pid_t parent = getpid();
+    for (int i = 0; i < num_workers; i++) {
+        Channel* channel = new (static_cast<char*>(shm_) + sizeof(Channel) * i) Channel();
+        if (sem_init(&channel->request, 1, 0) != 0 || sem_init(&channel->response, 1, 0) != 0) {
+            ALOGE("sem_init for g2p worker %d failed! %s", i, strerror(errno));
+            stop();
+            return false;
+        }
+
+        workers_.push_back(Worker{-1, channel, 0, 0});
+        if (!spawn_(workers_.back(), parent)) {
+            stop();
+            return false;
+        }
+        free_workers_.push_back(&workers_.back());
+        num_alive_++;
+    }
+
+    ALOGI("Started %d g2p worker processes", num_workers);
+    return true;
+}
+
+void EspeakWorkerPool::stop() {
+    if (!shm_)
+        return;
+
+    // 先全部通知再逐个等待, 各 worker 同时退出
+    for (auto& worker : workers_) {
+        if (worker.pid > 0) {
+            worker.channel->quit = 1;
+            sem_post(&worker.channel->request);
+        }
+    }
+    for (auto& worker : workers_) {
+        reap_(worker);
+        sem_destroy(&worker.channel->request);
+        sem_destroy(&worker.channel->response);
+    }
+
+    munmap(shm_, shm_size_);
+    shm_ = nullptr;
+    shm_size_ = 0;
+    workers_.clear();
+    free_workers_.clear();
+    num_alive_ = 0;
+}
+
+int EspeakWorkerPool::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_alive_;
+}
+
+void EspeakWorkerPool::cache_stats(uint64_t& hits, uint64_t& misses) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hits = 0;
+    misses = 0;
+    for (const auto& worker : workers_) {
+        hits += worker.cache_hits;
+        misses += worker.cache_misses;
+    }
+}
+
+bool EspeakWorkerPool::run(const std::string& text, std::string& phonemes, int& err) {
+    if (text.size() > G2P_WORKER_BUF_SIZE) {
+        ALOGW("G2P text of %d bytes exceeds the worker buffer, run in this process", (int)text.size());
+        return false;
+    }
+
+    Worker* worker = acquire_worker_();
+    if (!worker) {
+        return false;
+    }
+
+    Channel* channel = worker->channel;
+    memcpy(channel->data, text.data(), text.size());
+    channel->size = (uint32_t)text.size();
+    sem_post(&channel->request);
+
+    bool alive = wait_response_(*worker);
+    bool ok = alive && !channel->overflow;
+    if (ok) {
+        phonemes.assign(channel->data, channel->size);
+        err = channel->err;
+    } else if (alive) {
+        ALOGW("G2P phonemes of %d bytes of text exceed the worker buffer, run in this process", (int)text.size());
+    }
+
+    release_worker_(worker, alive);
+    return ok;
+}
+
+bool EspeakWorkerPool::spawn_(Worker& worker, pid_t parent) {
+    // 持有 espeak 的锁 fork, 子进程中的这把锁不会停在别的线程加锁的状态
+    std::mutex& espeak_mutex = EspeakG2P::get_global_mutex();
+    espeak_mutex.lock();
+    pid_t pid = fork();
+    espeak_mutex.unlock();
+
+    if (pid < 0) {
+        ALOGE("fork g2p worker failed! %s", strerror(errno));
+        return false;
+    }
+    if (pid == 0) {
+        worker_main_(worker.channel, parent, espeak_data_path_, language_, cache_words_);
+        // 不执行主进程注册的 atexit 和静态析构
+        _exit(0);
+    }
+
+    worker.pid = pid;
+    return true;
+}
+
+bool EspeakWorkerPool::wait_response_(Worker& worker) {
+    while (true) {
+        if (timed_wait(&worker.channel->response)) {
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != ETIMEDOUT) {
+            ALOGE("Wait g2p worker %d failed! %s", (int)worker.pid, strerror(errno));
+            break;
+        }
+
+        // 长文本可能要跑很久, 只要 worker 还在就继续等
+        pid_t ret = waitpid(worker.pid, NULL, WNOHANG);
+        if (ret == 0) {
+            continue;
+        }
+        // SIGCHLD 被忽略时子进程自动回收, waitpid 返回 ECHILD
+        if (ret < 0 && errno == ECHILD && kill(worker.pid, 0) == 0) {
+            continue;
+        }
+        ALOGE("G2P worker %d exited unexpectedly!", (int)worker.pid);
+        worker.pid = -1;
+        return false;
+    }
+
+    // 状态未知, 结果可能之后才写回, 不再使用这个 worker
+    kill(worker.pid, SIGKILL);
+    reap_(worker);
+    return false;
+}
+
+void EspeakWorkerPool::reap_(Worker& worker) {
+    if (worker.pid <= 0)
+        return;
+
+    while (waitpid(worker.pid, NULL, 0) < 0 && errno == EINTR) {
+    }
+    worker.pid = -1;
+}
+
+EspeakWorkerPool::Worker* EspeakWorkerPool::acquire_worker_() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !free_workers_.empty() || num_alive_ == 0; });
+    if (free_workers_.empty()) {
+        return nullptr;
+    }
+
+    Worker* worker = free_workers_.back();
+    free_workers_.pop_back();
+    return worker;
+}
+
+void EspeakWorkerPool::release_worker_(Worker* worker, bool alive) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (alive) {
+            // worker 空闲, 不会再写 channel
+            worker->cache_hits = worker->channel->cache_hits;
+            worker->cache_misses = worker->channel->cache_misses;
+            free_workers_.push_back(worker);
+        } else {
+            num_alive_--;
+            if (num_alive_ == 0) {
+                ALOGE("All g2p workers exited, fall back to espeak in this process");
+            }
+        }
+    }
+    // 最后一个 worker 退出时要唤醒所有等待的线程
+    cv_.notify_all();
+}
+
+void EspeakWorkerPool::worker_main_(Channel* channel, pid_t parent, const std::string& espeak_data_path,
+                                    const std::string& language, bool cache_words) {
+    // 主进程退出时一起退出: 空闲时定期检查父进程. 不用 PR_SET_PDEATHSIG, 它跟随 fork 的线程,
+    // 调用 start 的线程退出时 worker 也会被杀掉. worker 在加载模型之前 fork, 不持有 NPU 的资源
+    if (getppid() != parent) {
+        return;
+    }
+    // 终端的 Ctrl-C 发给整个进程组, 由主进程处理, worker 在 stop 时退出
+    signal(SIGINT, SIG_IGN);
+
+    EspeakG2P g2p(espeak_data_path.c_str());
+    g2p.set_cache_words(cache_words);
+
+    while (true) {
+        if (!timed_wait(&channel->request)) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ETIMEDOUT) {
+                if (getppid() != parent)
+                    return;
+                continue;
+            }
+            ALOGE("G2P worker wait request failed! %s", strerror(errno));
+            return;
+        }
+        if (channel->quit) {
+            return;
+        }
+
+        int err = 0;
+        std::string phonemes = g2p.run(std::string(channel->data, channel->size), language, err);
+        channel->err = err;
+        channel->cache_hits = g2p.get_cache().hits();
+        channel->cache_misses = g2p.get_cache().misses();
+        if (phonemes.size() > G2P_WORKER_BUF_SIZE) {
+            channel->overflow = 1;
+            channel->size = 0;
+        } else {
+            channel->overflow = 0;
+            memcpy(channel->data, phonemes.data(), phonemes.size());
+            channel->size = (uint32_t)phonemes.size();
+        }
+        sem_post(&channel->response);
+    }
+}
+
+} // namespace utils
@@ -0,0 +1,87 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <sys/types.h>
+
+#define G2P_WORKER_BUF_SIZE     (64 * 1024)     // 每个 worker 的共享缓冲, 放得下请求文本和返回的音素
+#define G2P_WORKER_POLL_MS      1000            // 等待结果时检查 worker 是否还活着的间隔
+
+namespace utils {
+
+// espeak-ng 使用全局状态, 同一进程内只能串行. 这里 fork 出多个子进程, 各自 espeak_Initialize,
+// 通过共享内存交换文本和音素, 多个线程可以同时做 G2P
+// start 应该在创建其它线程之前调用, 否则子进程可能继承别的线程持有的锁
+// 异常退出或超时的 worker 不再重启: 此时模型已经加载, 再 fork 会让子进程继承 NPU 的资源和其它线程持有的锁
+// 剩下的 worker 继续处理请求, 全部退出后 run 返回 false, 由调用者在本进程内处理
+class EspeakWorkerPool {
+public:
+    EspeakWorkerPool() = default;
+    ~EspeakWorkerPool() {
+        stop();
+    }
+
+    EspeakWorkerPool(const EspeakWorkerPool&) = delete;
+    EspeakWorkerPool& operator=(const EspeakWorkerPool&) = delete;
+
+    // cache_words 见 EspeakG2P::set_cache_words, 每个 worker 有自己的音素缓存
+    bool start(int num_workers, const std::string& espeak_data_path, const std::string& language, 
+               bool cache_words = false);
+    void stop();
+
+    // 还在运行的 worker 数
+    int size();
+
+    // 所有 worker 的音素缓存累计命中和未命中的次数, 包括已经退出的 worker
+    void cache_stats(uint64_t& hits, uint64_t& misses);
+
+    // 在空闲的 worker 中运行 EspeakG2P, 都在忙时等待. 线程安全
+    // 返回 false 表示没有处理: 没有 worker, 文本或音素超出共享缓冲, 或者 worker 异常退出
+    bool run(const std::string& text, std::string& phonemes, int& err);
+
+private:
+    struct Channel;
+    struct Worker {
+        pid_t pid;
+        Channel* channel;
+        uint64_t cache_hits;        // worker 最近一次返回结果时的缓存计数
+        uint64_t cache_misses;
+    };
+
+    bool spawn_(Worker& worker, pid_t parent);
+    bool wait_response_(Worker& worker);
+    void reap_(Worker& worker);
+
+    Worker* acquire_worker_();
+    void release_worker_(Worker* worker, bool alive);
+
+    static void worker_main_(Channel* channel, pid_t parent, const std::string& espeak_data_path,
+                             const std::string& language, bool cache_words);
+
+private:
+    std::string espeak_data_path_;
+    std::string language_;
+    bool cache_words_ = false;
+    void* shm_ = nullptr;
+    size_t shm_size_ = 0;
+
+    std::vector<Worker> workers_;
+    std::vector<Worker*> free_workers_;
+    int num_alive_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace utils
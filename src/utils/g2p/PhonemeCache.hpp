@@ -0,0 +1,123 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#define PHONEME_CACHE_ENTRY_OVERHEAD    64      // 估算的每条记录在链表和哈希表中的额外开销, 字节
+
+namespace utils {
+
+// 文本 -> 音素的 LRU 缓存, 按键和值的字节数加上固定开销限制内存, 超出时淘汰最久未用的
+// 线程安全, 容量为 0 时不缓存
+class PhonemeCache {
+public:
+    PhonemeCache(size_t capacity):
+        capacity_(capacity) {}
+
+    ~PhonemeCache() = default;
+
+    bool get(const std::string& key, std::string& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // 移到表头, 表尾是最久未用的
+        entries_.splice(entries_.begin(), entries_, it->second);
+        value = it->second->second;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void put(const std::string& key, const std::string& value) {
+        size_t bytes = entry_bytes_(key, value);
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 其它线程可能已经放进来了
+        if (bytes > capacity_ || index_.count(key))
+            return;
+
+        entries_.emplace_front(key, value);
+        index_[key] = entries_.begin();
+        size_ += bytes;
+        evict_(capacity_);
+    }
+
+    void set_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        evict_(capacity_);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict_(0);
+        hits_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+    }
+
+    inline uint64_t hits() const {
+        return hits_.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t misses() const {
+        return misses_.load(std::memory_order_relaxed);
+    }
+
+    float hit_rate() const {
+        uint64_t h = hits(), m = misses();
+        return (h + m) > 0 ? (float)h / (h + m) : 0.0f;
+    }
+
+    // 当前占用的字节数(估算)和条数
+    size_t size_bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    size_t num_entries() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    static size_t entry_bytes_(const std::string& key, const std::string& value) {
+        // 键在链表和哈希表中各存一份
+        return key.size() * 2 + value.size() + PHONEME_CACHE_ENTRY_OVERHEAD;
+    }
+
+    void evict_(size_t capacity) {
+        while (size_ > capacity && !entries_.empty()) {
+            auto& last = entries_.back();
+            size_ -= entry_bytes_(last.first, last.second);
+            index_.erase(last.first);
+            entries_.pop_back();
+        }
+    }
+
+private:
+    typedef std::list<std::pair<std::string, std::string>> EntryList;
+
+    size_t capacity_;
+    size_t size_ = 0;
+    EntryList entries_;
+    std::unordered_map<std::string, EntryList::iterator> index_;
+    std::mutex mutex_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace utils
@@ -0,0 +1,102 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace utils {
+
+typedef std::vector<std::pair<std::string, std::string>>    RewriteRules;
+
+// 多模式字符串替换, 构造时把所有模式建成按字节的 trie, run 一次遍历完成全部替换
+// 每个位置取最长的匹配, 替换结果不再参与匹配. 模式都是合法的 UTF-8 时不会匹配到半个字符
+// Example: {"aɪ" -> "I", "a" -> "A"}: 'aɪa' -> 'IA'
+class PhonemeRewriter {
+public:
+    PhonemeRewriter(const RewriteRules& rules) {
+        new_node_();
+        for (const auto& [from, to] : rules) {
+            // 空模式没有意义, 重复的模式保留第一个
+            if (from.empty())
+                continue;
+
+            int32_t node = 0;
+            for (char c : from) {
+                int32_t& next = next_[node * 256 + static_cast<unsigned char>(c)];
+                if (next < 0) {
+                    // new_node_ 会让 next_ 扩容, 不能再用引用
+                    int32_t child = new_node_();
+                    next_[node * 256 + static_cast<unsigned char>(c)] = child;
+                    node = child;
+                } else {
+                    node = next;
+                }
+            }
+
+            if (rule_[node] < 0) {
+                rule_[node] = (int32_t)targets_.size();
+                targets_.push_back(to);
+            }
+        }
+    }
+
+    ~PhonemeRewriter() = default;
+
+    inline size_t size() const {
+        return targets_.size();
+    }
+
+    std::string run(const std::string& text) const {
+        std::string result;
+        result.reserve(text.size());
+
+        size_t i = 0;
+        while (i < text.size()) {
+            // 从 i 开始沿 trie 往下走, 记住最后一个匹配的模式
+            int32_t node = 0;
+            int32_t matched = -1;
+            size_t matched_len = 0;
+            for (size_t k = i; k < text.size(); k++) {
+                node = next_[node * 256 + static_cast<unsigned char>(text[k])];
+                if (node < 0)
+                    break;
+                if (rule_[node] >= 0) {
+                    matched = rule_[node];
+                    matched_len = k - i + 1;
+                }
+            }
+
+            if (matched < 0) {
+                result.push_back(text[i]);
+                i++;
+            } else {
+                result.append(targets_[matched]);
+                i += matched_len;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    int32_t new_node_() {
+        next_.resize(next_.size() + 256, -1);
+        rule_.push_back(-1);
+        return (int32_t)rule_.size() - 1;
+    }
+
+private:
+    std::vector<int32_t> next_;         // 节点数 x 256 的转移表, -1 表示没有
+    std::vector<int32_t> rule_;         // 每个节点结束的模式在 targets_ 中的下标, -1 表示没有
+    std::vector<std::string> targets_;
+};
+
+} // namespace utils
@@ -10,8 +10,8 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <regex>
-#include <map>
+#include <algorithm>
+#include <cstdint>
 
 #define _DEFAULT_MARKS  ";:,.!?¡¿—…\"«»“”(){}[]"
 
@@ -27,7 +27,24 @@ class Punctuator {
 public:
     Punctuator(const std::string& marks = _DEFAULT_MARKS):
         marks_(marks) {
-
+        // 标点按码位建表, 只在构造时做一次. ASCII 查位图, 其余的二分查找
+        size_t i = 0;
+        while (i < marks_.size()) {
+            size_t len = 0;
+            uint32_t cp = decode_utf8_(marks_, i, len);
+            // 非法的 UTF-8 不作为标点, 否则输入中的每个非法字节都会被当成标点
+            if (cp == UTF8_INVALID) {
+                i += len;
+                continue;
+            }
+            if (cp < 128) {
+                ascii_marks_[cp] = true;
+            } else {
+                other_marks_.push_back(cp);
+            }
+            i += len;
+        }
+        std::sort(other_marks_.begin(), other_marks_.end());
     }
 
     ~Punctuator() = default;
@@ -40,63 +57,103 @@ public:
         return marks_;
     }
 
-    std::vector<LineMarkPair> run(const std::string& text) {
-        return split_by_marks_(text, marks_);
+    std::vector<LineMarkPair> run(const std::string& text) const {
+        return split_by_marks_(text);
     }
 
 private:
-    std::vector<LineMarkPair> split_by_marks_(
-        const std::string& str, const std::string& delimiterChars) {
-        
-        std::vector<std::pair<std::string, std::string>> result;
+    // 一次遍历: 连续的非标点字符为一段, 每个标点(整个 UTF-8 字符)挂到前一段上
+    std::vector<LineMarkPair> split_by_marks_(const std::string& str) const {
+        std::vector<LineMarkPair> result;
         
         if (str.empty()) return result;
-        if (delimiterChars.empty()) {
+        if (marks_.empty()) {
             result.emplace_back(str, "");
             return result;
         }
         
-        // 转义特殊字符以构建安全的正则表达式
-        std::string escaped;
-        for (char c : delimiterChars) {
-            if (c == '\\' || c == '^' || c == '$' || c == '.' || c == '|' ||
-                c == '?' || c == '*' || c == '+' || c == '(' || c == ')' ||
-                c == '[' || c == ']' || c == '{' || c == '}') {
-                escaped += '\\';
+        size_t run_begin = 0;   // 当前非标点段的起点
+        size_t i = 0;
+        while (i < str.size()) {
+            size_t len = 0;
+            uint32_t cp = decode_utf8_(str, i, len);
+            if (!is_mark_(cp)) {
+                i += len;
+                continue;
             }
-            escaped += c;
-        }
-        
-        // 构建正则表达式：匹配分隔符或非分隔符序列
-        std::string pattern = "([^" + escaped + "]+)|([" + escaped + "])";
-        std::regex re(pattern);
-        
-        std::sregex_iterator it(str.begin(), str.end(), re);
-        std::sregex_iterator end;
-        
-        while (it != end) {
-            // 第一个捕获组：非分隔符内容
-            if ((*it)[1].matched) {
-                result.emplace_back((*it)[1].str(), "");
+
+            if (i > run_begin) {
+                result.emplace_back(str.substr(run_begin, i - run_begin), "");
             }
-            // 第二个捕获组：分隔符本身
-            else if ((*it)[2].matched) {
-                // 如果结果不为空且上一个token没有分隔符，则为上一个token设置分隔符
-                if (!result.empty() && result.back().second.empty()) {
-                    result.back().second = (*it)[2].str();
-                } else {
-                    // 否则作为独立的空token（开头就是分隔符的情况）
-                    result.emplace_back("", (*it)[2].str());
-                }
+
+            // 上一段还没有标点时挂在它后面, 否则(开头或连续的标点)作为独立的空段
+            if (!result.empty() && result.back().second.empty()) {
+                result.back().second.assign(str, i, len);
+            } else {
+                result.emplace_back("", str.substr(i, len));
             }
-            ++it;
+
+            i += len;
+            run_begin = i;
+        }
+
+        if (i > run_begin) {
+            result.emplace_back(str.substr(run_begin, i - run_begin), "");
         }
         
         return result;
     }
 
+    bool is_mark_(uint32_t cp) const {
+        if (cp < 128) {
+            return ascii_marks_[cp];
+        }
+        return std::binary_search(other_marks_.begin(), other_marks_.end(), cp);
+    }
+
+    // 解码 str[i] 开始的 UTF-8 字符, len 为字节数. 非法的字节单独算一个字符, 返回 UTF8_INVALID
+    static uint32_t decode_utf8_(const std::string& str, size_t i, size_t& len) {
+        unsigned char lead = static_cast<unsigned char>(str[i]);
+        len = 1;
+        if (lead < 0x80) {
+            return lead;
+        }
+
+        size_t expect;
+        uint32_t cp;
+        if ((lead & 0xE0) == 0xC0) {
+            expect = 2;
+            cp = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            expect = 3;
+            cp = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            expect = 4;
+            cp = lead & 0x07;
+        } else {
+            return UTF8_INVALID;
+        }
+
+        if (i + expect > str.size()) {
+            return UTF8_INVALID;
+        }
+        for (size_t k = 1; k < expect; k++) {
+            unsigned char ch = static_cast<unsigned char>(str[i + k]);
+            if ((ch & 0xC0) != 0x80) {
+                return UTF8_INVALID;
+            }
+            cp = (cp << 6) | (ch & 0x3F);
+        }
+        len = expect;
+        return cp;
+    }
+
 private:
+    static const uint32_t UTF8_INVALID = 0xFFFFFFFF;   // 不会出现在标点表中
+
     std::string marks_;
+    bool ascii_marks_[128] = {};
+    std::vector<uint32_t> other_marks_;
 };
 
 } // namespace utils
\ No newline at end of file
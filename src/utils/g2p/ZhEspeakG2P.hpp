@@ -26,6 +26,10 @@ public:
     
     std::string get_language() const override { return "zh"; }
     std::string get_backend() const override { return "espeak"; }
+
+    // 按段(或按词)缓存的 espeak 输出, 可以查看命中率或调整容量
+    inline PhonemeCache& get_cache() { return espeak_.get_cache(); }
+    inline void set_cache_words(bool words) { espeak_.set_cache_words(words); }
     
     std::string run(const std::string& input_text, int& err) {
         std::string result = espeak_.run(input_text, get_language(), err);
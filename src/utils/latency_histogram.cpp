@@ -0,0 +1,97 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "latency_histogram.hpp"
+
+#include <cmath>
+
+namespace utils {
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucket_index_(uint64_t us) {
+    // [0, 8) 每个值一个桶; 之后 [2^o, 2^(o+1)) 分 8 个桶
+    if (us < SUB_BUCKETS)
+        return (int)us;
+
+    int octave = 63 - __builtin_clzll(us);
+    int sub = (int)(us >> (octave - SUB_BITS)) & (SUB_BUCKETS - 1);
+    int index = (octave - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+}
+
+double LatencyHistogram::bucket_mid_(int index) {
+    if (index < SUB_BUCKETS)
+        return index;
+
+    int octave = index / SUB_BUCKETS + SUB_BITS - 1;
+    int sub = index % SUB_BUCKETS;
+    double width = std::ldexp(1.0, octave - SUB_BITS);
+    return (SUB_BUCKETS + sub + 0.5) * width;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    buckets_[bucket_index_(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev = max_.load(std::memory_order_relaxed);
+    while (us > prev && !max_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const {
+    return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::percentile(double q) const {
+    // 先取一份桶的快照, 总数按快照算, 避免与并发的 record 不一致
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    // 第 ceil(q * total) 个样本所在的桶
+    uint64_t rank = (uint64_t)std::ceil(q * total);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return bucket_mid_(i);
+    }
+    return bucket_mid_(NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace utils
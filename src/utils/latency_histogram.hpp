@@ -0,0 +1,48 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace utils {
+
+// 无锁的耗时直方图, 单位微秒, 可以在任意线程并发 record
+// 每个 2 的幂区间再等分成 8 个桶, 分位数的相对误差在 1/8 以内, 范围到约 67 秒
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t us);
+
+    uint64_t count() const;
+    uint64_t sum() const;
+    uint64_t max() const;
+    // q in [0, 1], 返回所在桶的中点, 没有数据时返回 0
+    double percentile(double q) const;
+
+    // 与 record 并发时, 正在写入的样本可能一半计入一半清零, 只用于统计
+    void reset();
+
+private:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int NUM_BUCKETS = (26 - SUB_BITS + 1) * SUB_BUCKETS + SUB_BUCKETS;
+
+    static int bucket_index_(uint64_t us);
+    static double bucket_mid_(int index);
+
+    std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+} // namespace utils
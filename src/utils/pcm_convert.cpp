@@ -0,0 +1,84 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "pcm_convert.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PCM_USE_NEON
+#endif
+
+#define S16_SCALE   32767.0f
+#define U24_TO_UNIT (1.0f / 16777216.0f)   // xorshift 高 24 位映射到 [0, 1)
+
+namespace utils {
+
+static inline int16_t scalar_s16(float x) {
+    float v = std::max(-32768.0f, std::min(x * S16_SCALE, 32767.0f));
+    return (int16_t)lrintf(v);
+}
+
+static inline uint32_t xorshift32(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+void float_to_s16(const float* in, size_t len, int16_t* out) {
+    size_t i = 0;
+#ifdef PCM_USE_NEON
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    for (; i + 8 <= len; i += 8) {
+        int32x4_t lo = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i), scale));
+        int32x4_t hi = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), scale));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < len; i++) {
+        out[i] = scalar_s16(in[i]);
+    }
+}
+
+void float_to_s16_dither(const float* in, size_t len, int16_t* out, DitherState& state) {
+    // 抖动 = (r1 - r2) LSB, r1 / r2 取相邻两次 xorshift 的高 24 位
+    size_t i = 0;
+#ifdef PCM_USE_NEON
+    uint32x4_t s = vld1q_u32(state.seed);
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    const float32x4_t unit = vdupq_n_f32(U24_TO_UNIT);
+    auto next = [&s, &unit]() {
+        s = veorq_u32(s, vshlq_n_u32(s, 13));
+        s = veorq_u32(s, vshrq_n_u32(s, 17));
+        s = veorq_u32(s, vshlq_n_u32(s, 5));
+        return vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(s, 8)), unit);
+    };
+    for (; i + 4 <= len; i += 4) {
+        float32x4_t r1 = next();
+        float32x4_t r2 = next();
+        float32x4_t v = vfmaq_f32(vsubq_f32(r1, r2), vld1q_f32(in + i), scale);
+        v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+        vst1_s16(out + i, vqmovn_s32(vcvtnq_s32_f32(v)));
+    }
+    vst1q_u32(state.seed, s);
+#endif
+    for (; i < len; i++) {
+        uint32_t& seed = state.seed[i % 4];
+        float r1 = (xorshift32(seed) >> 8) * U24_TO_UNIT;
+        float r2 = (xorshift32(seed) >> 8) * U24_TO_UNIT;
+        float v = fmaf(in[i], S16_SCALE, r1 - r2);
+        v = std::max(-32768.0f, std::min(v, 32767.0f));
+        out[i] = (int16_t)lrintf(v);
+    }
+}
+
+}
@@ -0,0 +1,28 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+
+// float [-1, 1] -> int16, 超出范围饱和, 四舍五入到最近 (ties-to-even)
+// aarch64 上走 NEON, 其余平台是逐个样本的标量循环 (-O2 且没有 -ffast-math 时 lrintf 不会被向量化)
+void float_to_s16(const float* in, size_t len, int16_t* out);
+
+// 三角分布 (TPDF) 抖动, 幅度 ±1 LSB
+// 4 路独立的 xorshift32, NEON 与标量实现的结果完全一致
+struct DitherState {
+    uint32_t seed[4] = {0x9E3779B9u, 0x7F4A7C15u, 0x85EBCA6Bu, 0xC2B2AE35u};
+};
+void float_to_s16_dither(const float* in, size_t len, int16_t* out, DitherState& state);
+
+}
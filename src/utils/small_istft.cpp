@@ -0,0 +1,132 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "small_istft.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace utils {
+
+SmallISTFT::SmallISTFT(int n_fft, int hop_length)
+    : n_fft_(n_fft),
+      n_freq_(n_fft / 2 + 1),
+      hop_(hop_length) {
+    const double pi = 3.14159265358979323846;
+
+    // 周期 hann 窗, 与 librosa.h 中一致
+    std::vector<double> window(n_fft_);
+    window_sq_.resize(n_fft_);
+    for (int n = 0; n < n_fft_; n++) {
+        window[n] = 0.5 * (1.0 - cos(2.0 * pi * n / n_fft_));
+        window_sq_[n] = float(window[n] * window[n]);
+    }
+
+    // x[n] = 1/N * sum_k (Re(X_k) cos(2πkn/N) - Im(X_k) sin(2πkn/N))
+    // 负频率由共轭对称给出, 所以除 DC 和 Nyquist 外每个 bin 计 2 次
+    // Nyquist 只取实部, sin(πn) = 0 时自然满足
+    cos_tab_.resize(n_freq_ * n_fft_);
+    sin_tab_.resize(n_freq_ * n_fft_);
+    for (int k = 0; k < n_freq_; k++) {
+        bool self_conj = (k == 0) || (n_fft_ % 2 == 0 && k == n_fft_ / 2);
+        double scale = (self_conj ? 1.0 : 2.0) / n_fft_;
+        for (int n = 0; n < n_fft_; n++) {
+            // k*n 先取模, 避免大角度的精度损失
+            double angle = 2.0 * pi * ((k * n) % n_fft_) / n_fft_;
+            cos_tab_[k * n_fft_ + n] = float(scale * window[n] * cos(angle));
+            sin_tab_[k * n_fft_ + n] = float(-scale * window[n] * sin(angle));
+        }
+    }
+
+    block_.resize(n_fft_ * BLOCK_FRAMES);
+    stage_re_.resize(n_freq_ * BLOCK_FRAMES);
+    stage_im_.resize(n_freq_ * BLOCK_FRAMES);
+}
+
+size_t SmallISTFT::output_length(int num_frames) const {
+    return num_frames > 1 ? size_t(hop_) * (num_frames - 1) : 0;
+}
+
+void SmallISTFT::prepare_norm_(int num_frames) {
+    if (norm_frames_ == num_frames)
+        return;
+
+    // 与 librosa.h 保持一致: center 时帧起点和裁剪都偏移 n_fft/2, 相互抵消,
+    // 第 i 帧在输出中的起点就是 i * hop
+    int out_len = int(output_length(num_frames));
+    inv_win_sum_.assign(out_len, 0.0f);
+    for (int i = 0; i < num_frames; i++) {
+        int start = i * hop_;
+        int n_end = std::min(n_fft_, out_len - start);
+        for (int n = 0; n < n_end; n++) {
+            inv_win_sum_[start + n] += window_sq_[n];
+        }
+    }
+
+    for (auto& v : inv_win_sum_) {
+        v = std::abs(v) < 1e-10f ? 1.0f : 1.0f / v;
+    }
+    norm_frames_ = num_frames;
+}
+
+void SmallISTFT::run(const float* real, const float* imag, int num_frames, float* out) {
+    int out_len = int(output_length(num_frames));
+    if (out_len == 0)
+        return;
+
+    prepare_norm_(num_frames);
+    std::fill(out, out + out_len, 0.0f);
+
+    // 按帧分块, 块内 block[n][f] = sum_k tab[k][n] * X[k][f]
+    // 输入先拷到补零的定长暂存区, 最内层循环次数固定且连续, -O2 下也能向量化
+    float* block = block_.data();
+    float* stage_re = stage_re_.data();
+    float* stage_im = stage_im_.data();
+    for (int f0 = 0; f0 < num_frames; f0 += BLOCK_FRAMES) {
+        int nf = std::min(BLOCK_FRAMES, num_frames - f0);
+        if (nf < BLOCK_FRAMES) {
+            std::fill(stage_re_.begin(), stage_re_.end(), 0.0f);
+            std::fill(stage_im_.begin(), stage_im_.end(), 0.0f);
+        }
+        for (int k = 0; k < n_freq_; k++) {
+            std::copy(real + k * num_frames + f0, real + k * num_frames + f0 + nf, stage_re + k * BLOCK_FRAMES);
+            std::copy(imag + k * num_frames + f0, imag + k * num_frames + f0 + nf, stage_im + k * BLOCK_FRAMES);
+        }
+
+        std::fill(block_.begin(), block_.end(), 0.0f);
+        for (int k = 0; k < n_freq_; k++) {
+            const float* __restrict re = stage_re + k * BLOCK_FRAMES;
+            const float* __restrict im = stage_im + k * BLOCK_FRAMES;
+            const float* c = cos_tab_.data() + k * n_fft_;
+            const float* s = sin_tab_.data() + k * n_fft_;
+            for (int n = 0; n < n_fft_; n++) {
+                float* __restrict dst = block + n * BLOCK_FRAMES;
+                float cn = c[n], sn = s[n];
+                for (int f = 0; f < BLOCK_FRAMES; f++) {
+                    dst[f] += re[f] * cn + im[f] * sn;
+                }
+            }
+        }
+
+        // 重叠相加, 超出输出长度的部分丢弃
+        for (int f = 0; f < nf; f++) {
+            int start = (f0 + f) * hop_;
+            int n_end = std::min(n_fft_, out_len - start);
+            for (int n = 0; n < n_end; n++) {
+                out[start + n] += block[n * BLOCK_FRAMES + f];
+            }
+        }
+    }
+
+    for (int j = 0; j < out_len; j++) {
+        out[j] *= inv_win_sum_[j];
+    }
+}
+
+}
@@ -0,0 +1,55 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace utils {
+
+// 小点数 iSTFT, 等价于 librosa::Feature::istft(x, n_fft, hop, "hann", center=true, "reflect", false)
+// n_fft 很小 (Kokoro 为 20) 时直接做实数逆 DFT 比通用 FFT 快,
+// 旋转因子、1/N 和 hann 窗都预先乘进查找表, 窗平方和的归一化按帧数缓存
+class SmallISTFT {
+public:
+    SmallISTFT(int n_fft, int hop_length);
+
+    int n_fft() const { return n_fft_; }
+    int n_freq() const { return n_freq_; }
+    int hop_length() const { return hop_; }
+
+    // center=true 时输出长度为 hop * (num_frames - 1)
+    size_t output_length(int num_frames) const;
+
+    // real / imag 按 [n_freq, num_frames] 行优先排列, out 至少 output_length(num_frames) 个元素
+    // 非线程安全: 归一化表会按 num_frames 重建
+    void run(const float* real, const float* imag, int num_frames, float* out);
+
+private:
+    static constexpr int BLOCK_FRAMES = 64;
+
+    void prepare_norm_(int num_frames);
+
+    int n_fft_;
+    int n_freq_;
+    int hop_;
+
+    std::vector<float> window_sq_;  // [n_fft]
+    std::vector<float> cos_tab_;    // [n_freq, n_fft], 含窗、1/N 与共轭对称的 2 倍
+    std::vector<float> sin_tab_;    // [n_freq, n_fft]
+    std::vector<float> block_;      // [n_fft, BLOCK_FRAMES]
+    std::vector<float> stage_re_;   // [n_freq, BLOCK_FRAMES]
+    std::vector<float> stage_im_;   // [n_freq, BLOCK_FRAMES]
+
+    int norm_frames_ = -1;
+    std::vector<float> inv_win_sum_;  // [output_length(norm_frames_)]
+};
+
+}
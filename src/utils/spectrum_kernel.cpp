@@ -0,0 +1,119 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include "spectrum_kernel.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SPECTRUM_USE_NEON
+#endif
+
+namespace utils {
+
+static inline void mag_phase_scalar(float log_mag, float phase_in, float& real, float& imag) {
+    float spec = expf(log_mag);
+    float phase = sinf(phase_in);
+    float cos_part = sqrtf(1.f - std::max(0.f, std::min(phase * phase, 1.0f)));
+    real = spec * cos_part;
+    imag = spec * phase;
+}
+
+#ifdef SPECTRUM_USE_NEON
+// exp / sin 的多项式系数来自 cephes, 与 neon_mathfun 相同, 相对误差约 1e-7
+static inline float32x4_t exp_ps(float32x4_t x) {
+    x = vminq_f32(x, vdupq_n_f32(88.3762626647949f));
+    x = vmaxq_f32(x, vdupq_n_f32(-88.3762626647949f));
+
+    // exp(x) = 2^n * exp(g), n = floor(x / ln2 + 0.5)
+    float32x4_t fx = vfmaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(1.44269504088896341f));
+    fx = vrndmq_f32(fx);
+    x = vfmaq_f32(x, fx, vdupq_n_f32(-0.693359375f));
+    x = vfmaq_f32(x, fx, vdupq_n_f32(2.12194440e-4f));
+
+    float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y = vdupq_n_f32(1.9875691500E-4f);
+    y = vfmaq_f32(vdupq_n_f32(1.3981999507E-3f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(8.3334519073E-3f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(4.1665795894E-2f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(1.6666665459E-1f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(5.0000001201E-1f), y, x);
+    y = vfmaq_f32(x, y, z);
+    y = vaddq_f32(y, vdupq_n_f32(1.0f));
+
+    int32x4_t n = vcvtq_s32_f32(fx);
+    n = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(0x7f)), 23);
+    return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+static inline float32x4_t sin_ps(float32x4_t x) {
+    uint32x4_t sign_mask = vcltq_f32(x, vdupq_n_f32(0.0f));
+    x = vabsq_f32(x);
+
+    // 按 pi/4 划分象限, j 取偶数
+    float32x4_t y = vmulq_f32(x, vdupq_n_f32(1.27323954473516f));
+    uint32x4_t j = vcvtq_u32_f32(y);
+    j = vandq_u32(vaddq_u32(j, vdupq_n_u32(1)), vdupq_n_u32(~1u));
+    y = vcvtq_f32_u32(j);
+
+    // 象限 1、2 用 cos 多项式, 象限 2、3 取反
+    uint32x4_t poly_mask = vtstq_u32(j, vdupq_n_u32(2));
+    sign_mask = veorq_u32(sign_mask, vtstq_u32(j, vdupq_n_u32(4)));
+
+    // 扩展精度的 x - y * pi/4
+    x = vfmaq_f32(x, y, vdupq_n_f32(-0.78515625f));
+    x = vfmaq_f32(x, y, vdupq_n_f32(-2.4187564849853515625e-4f));
+    x = vfmaq_f32(x, y, vdupq_n_f32(-3.77489497744594108e-8f));
+
+    float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y_cos = vdupq_n_f32(2.443315711809948E-005f);
+    y_cos = vfmaq_f32(vdupq_n_f32(-1.388731625493765E-003f), y_cos, z);
+    y_cos = vfmaq_f32(vdupq_n_f32(4.166664568298827E-002f), y_cos, z);
+    y_cos = vmulq_f32(y_cos, vmulq_f32(z, z));
+    y_cos = vfmaq_f32(y_cos, z, vdupq_n_f32(-0.5f));
+    y_cos = vaddq_f32(y_cos, vdupq_n_f32(1.0f));
+
+    float32x4_t y_sin = vdupq_n_f32(-1.9515295891E-4f);
+    y_sin = vfmaq_f32(vdupq_n_f32(8.3321608736E-3f), y_sin, z);
+    y_sin = vfmaq_f32(vdupq_n_f32(-1.6666654611E-1f), y_sin, z);
+    y_sin = vfmaq_f32(x, y_sin, vmulq_f32(z, x));
+
+    y = vbslq_f32(poly_mask, y_cos, y_sin);
+    return vbslq_f32(sign_mask, vnegq_f32(y), y);
+}
+#endif
+
+void mag_phase_to_complex(const float* log_mag, const float* phase, size_t len, float* real, float* imag) {
+    size_t i = 0;
+#ifdef SPECTRUM_USE_NEON
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (; i + 4 <= len; i += 4) {
+        float32x4_t spec = exp_ps(vld1q_f32(log_mag + i));
+        float32x4_t s = sin_ps(vld1q_f32(phase + i));
+        float32x4_t s2 = vminq_f32(vmulq_f32(s, s), one);
+        float32x4_t c = vsqrtq_f32(vmaxq_f32(vsubq_f32(one, s2), zero));
+        vst1q_f32(real + i, vmulq_f32(spec, c));
+        vst1q_f32(imag + i, vmulq_f32(spec, s));
+    }
+#endif
+    for (; i < len; i++) {
+        mag_phase_scalar(log_mag[i], phase[i], real[i], imag[i]);
+    }
+}
+
+void mag_phase_to_complex_ref(const float* log_mag, const float* phase, size_t len, float* real, float* imag) {
+    for (size_t i = 0; i < len; i++) {
+        mag_phase_scalar(log_mag[i], phase[i], real[i], imag[i]);
+    }
+}
+
+}
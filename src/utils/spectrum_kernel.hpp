@@ -0,0 +1,27 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#pragma once
+
+#include <cstddef>
+
+namespace utils {
+
+// 把 vocoder 输出的 (对数幅度, 相位) 转成复数谱的实部和虚部:
+//   spec = exp(log_mag), phase = sin(phase_in)
+//   real = spec * sqrt(1 - clamp(phase^2, 0, 1))
+//   imag = spec * phase
+// 输入只读一遍, real / imag 可以和输入是同一块内存
+// aarch64 上走 NEON 多项式近似 (cephes), 其余平台用 expf / sinf
+void mag_phase_to_complex(const float* log_mag, const float* phase, size_t len, float* real, float* imag);
+
+// 参考实现, 供测试和 benchmark 对比
+void mag_phase_to_complex_ref(const float* log_mag, const float* phase, size_t len, float* real, float* imag);
+
+}
@@ -0,0 +1,197 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include <stdio.h>
+#include <string>
+#include <regex>
+#include <random>
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+#include "utils/text_cleaner.hpp"
+#include "utils/timer.hpp"
+
+#define REPEAT      20
+#define NUM_RANDOM  20000
+
+// 原来的写法: 每次编译正则, 每个非 ASCII 字节位置 substr + unordered_map 查表
+static std::string legacy_fullwidth_to_halfwidth(const std::string& input) {
+    static const std::unordered_map<std::string, std::string> full_to_half = {
+        {"。", "."}, {"！", "!"}, {"？", "?"}, {"；", ";"}, {"，", ","}, {"、", ","}, {"：", ":"},
+        {"＂", "\""}, {"＇", "'"}, {"（", "("}, {"）", ")"}, {"【", "["}, {"】", "]"}, {"《", "<"}, {"》", ">"},
+        {"　", " "},
+        {"Ａ", "A"}, {"Ｂ", "B"}, {"Ｃ", "C"}, {"Ｄ", "D"}, {"Ｅ", "E"}, {"Ｆ", "F"}, {"Ｇ", "G"},
+        {"Ｈ", "H"}, {"Ｉ", "I"}, {"Ｊ", "J"}, {"Ｋ", "K"}, {"Ｌ", "L"}, {"Ｍ", "M"}, {"Ｎ", "N"},
+        {"Ｏ", "O"}, {"Ｐ", "P"}, {"Ｑ", "Q"}, {"Ｒ", "R"}, {"Ｓ", "S"}, {"Ｔ", "T"}, {"Ｕ", "U"},
+        {"Ｖ", "V"}, {"Ｗ", "W"}, {"Ｘ", "X"}, {"Ｙ", "Y"}, {"Ｚ", "Z"},
+        {"ａ", "a"}, {"ｂ", "b"}, {"ｃ", "c"}, {"ｄ", "d"}, {"ｅ", "e"}, {"ｆ", "f"}, {"ｇ", "g"},
+        {"ｈ", "h"}, {"ｉ", "i"}, {"ｊ", "j"}, {"ｋ", "k"}, {"ｌ", "l"}, {"ｍ", "m"}, {"ｎ", "n"},
+        {"ｏ", "o"}, {"ｐ", "p"}, {"ｑ", "q"}, {"ｒ", "r"}, {"ｓ", "s"}, {"ｔ", "t"}, {"ｕ", "u"},
+        {"ｖ", "v"}, {"ｗ", "w"}, {"ｘ", "x"}, {"ｙ", "y"}, {"ｚ", "z"},
+        {"０", "0"}, {"１", "1"}, {"２", "2"}, {"３", "3"}, {"４", "4"},
+        {"５", "5"}, {"６", "6"}, {"７", "7"}, {"８", "8"}, {"９", "9"},
+        {"～", "~"}, {"＠", "@"}, {"＃", "#"}, {"＄", "$"}, {"％", "%"}, {"＆", "&"}, {"＊", "*"},
+        {"＋", "+"}, {"－", "-"}, {"＝", "="}, {"＼", "\\"}, {"｜", "|"}, {"｛", "{"}, {"｝", "}"},
+        {"＾", "^"}, {"＿", "_"}, {"｀", "`"}, {"＜", "<"}, {"＞", ">"},
+    };
+
+    std::string result;
+    result.reserve(input.length());
+    size_t i = 0;
+    while (i < input.length()) {
+        unsigned char ch = static_cast<unsigned char>(input[i]);
+        if (ch < 128) {
+            result.push_back(input[i]);
+            i++;
+            continue;
+        }
+
+        if (i + 2 < input.length()) {
+            auto it = full_to_half.find(input.substr(i, 3));
+            if (it != full_to_half.end()) {
+                result += it->second;
+                i += 3;
+                continue;
+            }
+        }
+
+        int char_len = 1;
+        if ((ch & 0xF0) == 0xF0) char_len = 4;
+        else if ((ch & 0xE0) == 0xE0) char_len = 3;
+        else if ((ch & 0xC0) == 0xC0) char_len = 2;
+        result += input.substr(i, char_len);
+        i += char_len;
+    }
+    return result;
+}
+
+static std::string legacy_clean(const std::string& input_text) {
+    if (input_text.empty()) return "";
+
+    std::string text = legacy_fullwidth_to_halfwidth(input_text);
+    std::regex ws_re(R"(\s+)");
+    text = std::regex_replace(text, ws_re, " ");
+
+    auto not_whitespace = [](unsigned char ch) { return !std::isspace(ch); };
+    auto begin = std::find_if(text.begin(), text.end(), not_whitespace);
+    if (begin == text.end()) {
+        return "";
+    }
+    auto end = std::find_if(text.rbegin(), text.rend(), not_whitespace).base();
+    std::string trimmed(begin, end);
+
+    std::string filtered;
+    filtered.reserve(trimmed.length());
+    for (unsigned char ch : trimmed) {
+        if (ch >= 32 || ch == '\n' || ch == '\r' || ch == '\t') {
+            filtered.push_back(static_cast<char>(ch));
+        }
+    }
+    return filtered;
+}
+
+// 与原来有意不同的输入, 逐条断言新的结果
+// 控制字符先删掉再合并空白, 旁边的空白不会变成两个空格或留在首尾
+static int check_edge_cases(utils::TextCleaner& cleaner) {
+    struct Case {
+        const char* input;
+        const char* expected;
+    };
+    const Case cases[] = {
+        {"a \x01 b", "a b"},           // 原来是 "a  b"
+        {"\x01 a", "a"},               // 原来是 " a"
+        {"a \x01", "a"},               // 原来是 "a "
+        {"a\x01\x02 b", "a b"},
+        {"x\x1b y", "x y"},
+        {"  \x02  ", ""},
+        {"\x01", ""},
+        {"ａ\x01　ｂ", "a b"},         // 全角空格旁边的控制字符
+        {"a\t\x7f\nb", "a \x7f b"},   // DEL 不是控制字符, 与原来一致
+        {"．／［］", "./[]"},           // 原表漏掉的全角字符
+        {"a\xff b", "a\xff b"},        // 非法 UTF-8 原样保留
+        {"a\xe4\xb8 b", "a\xe4\xb8 b"},
+    };
+
+    int failed = 0;
+    for (const auto& c : cases) {
+        std::string output = cleaner.run(c.input);
+        if (output != c.expected) {
+            printf("edge case failed: [%s] -> [%s], expected [%s]\n", c.input, output.c_str(), c.expected);
+            failed++;
+        }
+    }
+    printf("edge cases: %d / %d failed\n", failed, (int)(sizeof(cases) / sizeof(cases[0])));
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    utils::TextCleaner cleaner;
+    int failed = check_edge_cases(cleaner);
+
+    // 随机拼接各类字符, 与原来的结果逐一比较
+    // 不含两者有意不同的输入: 原表漏掉的 ．／［］, 以及空白旁边的控制字符
+    // (原来先合并空白再删控制字符, 会留下两个空格或首尾空格)
+    const char* pieces[] = {
+        "a", "Z", "7", " ", "  ", "\t", "\n", "\r\n", "\v", "\f", ",", ".", "!", "中", "文", "語", "é", "ß",
+        "😀", "。", "！", "？", "；", "，", "、", "：", "（", "）", "【", "】", "《", "》", "　",
+        "Ａ", "ｚ", "０", "９", "～", "＠", "＂", "＇", "＼", "｛", "｝", "＜", "＞", "－", "＿", "＾", "｀",
+        "〈", "「", "」", "\x7f",
+    };
+    const int num_pieces = sizeof(pieces) / sizeof(pieces[0]);
+    std::mt19937 rng(0);
+    int mismatches = 0;
+    for (int n = 0; n < NUM_RANDOM; n++) {
+        std::string input;
+        int len = rng() % 24;
+        for (int k = 0; k < len; k++) {
+            input += pieces[rng() % num_pieces];
+        }
+        // 控制字符只放在两个普通字符之间
+        if (rng() % 4 == 0) {
+            input = "x" + std::string(1, char(1 + rng() % 8)) + "y" + input;
+        }
+
+        if (cleaner.run(input) != legacy_clean(input)) {
+            if (mismatches < 5) {
+                printf("mismatch: [%s] -> [%s] / legacy [%s]\n", input.c_str(), cleaner.run(input).c_str(), legacy_clean(input).c_str());
+            }
+            mismatches++;
+        }
+    }
+    printf("conformance: %d / %d random inputs differ from the legacy cleaner\n", mismatches, NUM_RANDOM);
+
+    // 长的中文输入
+    std::string paragraph = "人工智能（ＡＩ）正在改变我们的生活。　语音合成技术让机器能够“开口说话”，"
+                            "它被广泛用于导航、客服、有声读物等场景！\n\n    你准备好了吗？";
+    std::string long_text;
+    while (long_text.size() < 64 * 1024) {
+        long_text += paragraph;
+    }
+
+    std::string legacy_out, fast_out;
+    Timer timer;
+    for (int i = 0; i < REPEAT; i++) {
+        legacy_out = legacy_clean(long_text);
+    }
+    float legacy_ms = timer.elapsed() / REPEAT;
+
+    timer.start();
+    for (int i = 0; i < REPEAT; i++) {
+        fast_out = cleaner.run(long_text);
+    }
+    float fast_ms = timer.elapsed() / REPEAT;
+
+    printf("text cleaner, %d KB of Chinese text, %d runs\n", (int)(long_text.size() / 1024), REPEAT);
+    printf("legacy cleaner: %.3f ms\n", legacy_ms);
+    printf("single pass: %.3f ms (%.2fx)\n", fast_ms, legacy_ms / fast_ms);
+    printf("same output: %s\n", legacy_out == fast_out ? "yes" : "no");
+
+    return (failed > 0 || mismatches > 0 || legacy_out != fast_out) ? 1 : 0;
+}
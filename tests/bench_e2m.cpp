@@ -0,0 +1,150 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include <stdio.h>
+#include <string>
+#include <map>
+#include <regex>
+#include <random>
+
+#include "utils/g2p/EspeakG2P.hpp"
+#include "utils/timer.hpp"
+
+#define REPEAT      200
+#define NUM_RANDOM  100000
+
+// 原来的写法: std::map 按键的字节序逐条构造正则替换, 最后再删除 _
+static std::string legacy_postprocess(std::string phonemes) {
+    static const std::map<std::string, std::string> E2M = {
+        { R"(ʔˌn\u0329)", "tn" },
+        { R"(ʔn\u0329)", "tn" },
+        { R"(ʔn)", "tn" },
+        { R"(ʔ)", "t" },
+        { R"(aɪ)", "I" },
+        { R"(aʊ)", "W" },
+        { R"(dʒ)", "ʤ" },
+        { R"(eɪ)", "A" },
+        { R"(e)", "A" },
+        { R"(tʃ)", "ʧ" },
+        { R"(ɔɪ)", "Y" },
+        { R"(əl)", "ᵊl" },
+        { R"(ʲo)", "jo" },
+        { R"(ʲə)", "jə" },
+        { R"(ʲ)", "" },
+        { R"(ɚ)", "əɹ" },
+        { R"(r)", "ɹ" },
+        { R"(x)", "k" },
+        { R"(ç)", "k" },
+        { R"(ɐ)", "ə" },
+        { R"(ɬ)", "l" },
+        { R"(\u0303)", "" },
+        { R"(oʊ)", "O" },
+        { R"(ɜːɹ)", "ɜɹ" },
+        { R"(ɜː)", "ɜɹ" },
+        { R"(ɪə)", "iə" },
+        { R"(ː)", "" }
+    };
+    for (auto& [key, value]: E2M) {
+        phonemes = std::regex_replace(phonemes, std::regex(key), value);
+    }
+    phonemes = std::regex_replace(phonemes, std::regex(R"(_)"), "");
+    return phonemes;
+}
+
+// 与原来唯一有意的不同: 按 misaki 删掉鼻化符号 U+0303. 它不在 Kokoro 的 vocab 中, 不影响 token
+// 替换结果不再参与匹配, 所以等同于在原来的结果上删掉 U+0303
+static std::string expected_postprocess(const std::string& phonemes) {
+    std::string out = legacy_postprocess(phonemes);
+    const std::string nasal("\u0303");
+    size_t pos;
+    while ((pos = out.find(nasal)) != std::string::npos) {
+        out.erase(pos, nasal.size());
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    // espeak 输出的一些句子 (以 _ 分隔音素)
+    const char* sentences[] = {
+        "h_ə_l_ˈoʊ_ w_ˈɜː_l_d",
+        "ð_ɪ_s_ ɪ_z_ ɐ_ t_ˈɛ_s_t_ ə_v_ ð_ə_ t_ˈɛ_k_s_t_ t_ə_ s_ˈ_p_iː_tʃ_ s_ˈɪ_s_t_ə_m",
+        "ˈaɪ_ θ_ˈɪ_ŋ_k_ ð_ˈæ_t_ ɪ_t_s_ ɐ_ɡ_ˈʊ_d_ ˈaɪ_d_ˈiə_ b_ɚ_ k_ˈæ_t_ɚ_ɹ_ɪ_ŋ",
+        "m_ˈaʊ_n_t_ɪ_n_ b_ˈʌ_ʔ_n̩_ ˈoʊ_v_ɚ_ ð_ə_ ɹ_ˈeɪ_n_b_oʊ_ ɪ_n_ dʒ_ˈuː_n",
+        "p_ˈiː_p_əl_ l_ˈaɪ_k_ ð_ə_ b_ˈɔɪ_ɪ_n_ ð_ə_ k_ˈɑːɹ_ ˌɛ_n_θ_j_ˈuː_z_iː_ˌæ_z_ə_m",
+        "ni2_ x_ɑu3_ ʂ_ɻ̩5_ tɕ_iɛ4",
+    };
+
+    // 用到的音素和规则里出现的各个片段随机拼接
+    // 原来的正则里 \u0303 被截断成单字节 0x03, 删掉的是 0x03 而不是鼻化符号 U+0303, 两者都要覆盖
+    const char* pieces[] = {
+        "a", "ɪ", "ʊ", "d", "ʒ", "e", "o", "r", "t", "ʃ", "x", "ç", "ɐ", "ɔ", "ə", "l", "ɚ",
+        "ɜ", "ː", "ɹ", "ɬ", "ʔ", "n", "\u0329", "ˌ", "ˈ", "ʲ", "i", "k", "s", "ŋ", "æ", "ʌ",
+        "_", " ", ",", ".", "?", ")", "aɪ", "eɪ", "oʊ", "ɜːɹ", "ɪə", "ɐl", "ʲo", "ʲə", "ᵊ",
+        "\u0303", "\x03", "ɑ\u0303",
+    };
+    const int num_pieces = sizeof(pieces) / sizeof(pieces[0]);
+
+    int mismatches = 0;
+    for (const char* sentence : sentences) {
+        std::string out = utils::EspeakG2P::apply_e2m(sentence);
+        printf("%s -> %s\n", sentence, out.c_str());
+        if (out != expected_postprocess(sentence)) {
+            mismatches++;
+        }
+    }
+
+    std::mt19937 rng(0);
+    for (int n = 0; n < NUM_RANDOM; n++) {
+        std::string input;
+        int len = rng() % 24;
+        for (int k = 0; k < len; k++) {
+            input += pieces[rng() % num_pieces];
+        }
+
+        if (utils::EspeakG2P::apply_e2m(input) != expected_postprocess(input)) {
+            if (mismatches < 5) {
+                printf("mismatch: [%s] -> [%s] / expected [%s]\n", input.c_str(), utils::EspeakG2P::apply_e2m(input).c_str(), expected_postprocess(input).c_str());
+            }
+            mismatches++;
+        }
+    }
+    printf("conformance: %d / %d inputs differ from the legacy regex replacement (U+0303 removed)\n", 
+        mismatches, NUM_RANDOM + (int)(sizeof(sentences) / sizeof(sentences[0])));
+
+    std::string long_text;
+    for (int i = 0; i < 4; i++) {
+        for (const char* sentence : sentences) {
+            long_text += sentence;
+            long_text += " ";
+        }
+    }
+
+    std::string legacy_out, fast_out;
+    Timer timer;
+    for (int i = 0; i < REPEAT; i++) {
+        legacy_out = legacy_postprocess(long_text);
+    }
+    float legacy_ms = timer.elapsed() / REPEAT;
+
+    timer.start();
+    for (int i = 0; i < REPEAT; i++) {
+        fast_out = utils::EspeakG2P::apply_e2m(long_text);
+    }
+    float fast_ms = timer.elapsed() / REPEAT;
+
+    printf("e2m postprocess, %d bytes of phonemes, %d runs\n", (int)long_text.size(), REPEAT);
+    printf("legacy regex: %.4f ms\n", legacy_ms);
+    printf("rewriter: %.4f ms (%.2fx)\n", fast_ms, legacy_ms / fast_ms);
+    printf("same output: %s\n", legacy_out == fast_out ? "yes" : "no");
+    // 鼻化符号在原来的结果里保留, 在新的结果里删除
+    bool nasal_ok = utils::EspeakG2P::apply_e2m("ɑ\u0303") == "ɑ" && legacy_postprocess("ɑ\u0303") == "ɑ\u0303";
+    printf("nasalization removed: %s\n", nasal_ok ? "yes" : "no");
+
+    return (mismatches > 0 || legacy_out != fast_out || !nasal_ok) ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <complex>
+#include <random>
+#include <algorithm>
+
+#include "utils/spectrum_kernel.hpp"
+#include "utils/timer.hpp"
+
+#define N_FFT       20
+#define NUM_FRAMES  7680    // 24kHz 下约 1.6 秒音频
+#define REPEAT      200
+
+typedef std::vector<std::vector<std::complex<float>>> FFT_RESULT;
+
+// 原来 postprocess_x_to_audio_ 里的写法: 三个临时数组 + 嵌套 vector 的复数谱
+static void legacy_loop(const std::vector<float>& x, int num_frames, FFT_RESULT& complex_spec) {
+    int half_n_fft = N_FFT / 2 + 1;
+    std::vector<float> spec_part(half_n_fft * num_frames);
+    std::vector<float> phase_part(half_n_fft * num_frames);
+    std::vector<float> cos_part(half_n_fft * num_frames);
+    spec_part.assign(x.begin(), x.begin() + half_n_fft * num_frames);
+    phase_part.assign(x.begin() + half_n_fft * num_frames, x.end());
+
+    for (int i = 0; i < half_n_fft * num_frames; i++) {
+        spec_part[i] = expf(spec_part[i]);
+        phase_part[i] = sinf(phase_part[i]);
+        cos_part[i] = sqrtf(1.f - std::max(0.f, std::min(powf(phase_part[i], 2), 1.0f)));
+    }
+
+    complex_spec = FFT_RESULT(half_n_fft, std::vector<std::complex<float>>(num_frames));
+    for (int i = 0; i < half_n_fft; i++) {
+        for (int n = 0; n < num_frames; n++) {
+            float spec = spec_part[i * num_frames + n];
+            complex_spec[i][n] = std::complex<float>(spec * cos_part[i * num_frames + n], spec * phase_part[i * num_frames + n]);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int half_n_fft = N_FFT / 2 + 1;
+    size_t spec_len = half_n_fft * NUM_FRAMES;
+
+    // 对数幅度和相位的取值范围参照真实模型输出
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> mag_dist(-12.0f, 6.0f);
+    std::uniform_real_distribution<float> phase_dist(-40.0f, 40.0f);
+    std::vector<float> x(spec_len * 2);
+    for (size_t i = 0; i < spec_len; i++) {
+        x[i] = mag_dist(rng);
+        x[spec_len + i] = phase_dist(rng);
+    }
+
+    FFT_RESULT complex_spec;
+    std::vector<float> real(spec_len), imag(spec_len);
+
+    Timer timer;
+    for (int i = 0; i < REPEAT; i++) {
+        legacy_loop(x, NUM_FRAMES, complex_spec);
+    }
+    float legacy_ms = timer.elapsed() / REPEAT;
+
+    timer.start();
+    for (int i = 0; i < REPEAT; i++) {
+        utils::mag_phase_to_complex(x.data(), x.data() + spec_len, spec_len, real.data(), imag.data());
+    }
+    float fused_ms = timer.elapsed() / REPEAT;
+
+    // 误差相对幅度计算, 避免大幅度处的绝对误差掩盖结果
+    float max_err = 0;
+    for (int i = 0; i < half_n_fft; i++) {
+        for (int n = 0; n < NUM_FRAMES; n++) {
+            size_t idx = i * NUM_FRAMES + n;
+            float mag = expf(x[idx]);
+            max_err = std::max(max_err, fabsf(complex_spec[i][n].real() - real[idx]) / mag);
+            max_err = std::max(max_err, fabsf(complex_spec[i][n].imag() - imag[idx]) / mag);
+        }
+    }
+
+    printf("spectrum kernel, %d bins x %d frames, %d runs\n", half_n_fft, NUM_FRAMES, REPEAT);
+    printf("legacy loop: %.3f ms\n", legacy_ms);
+    printf("fused kernel: %.3f ms (%.2fx)\n", fused_ms, legacy_ms / fused_ms);
+    printf("max relative error: %g\n", max_err);
+
+    return 0;
+}
@@ -8,12 +8,19 @@
  *
  **************************************************************************************************/
 #include <stdio.h>
+#include <thread>
+#include <atomic>
 
 #include "utils/cmdline.hpp"
 #include "utils/logger.h"
+#include "utils/timer.hpp"
 #include "utils/g2p/EspeakG2P.hpp"
 #include "utils/g2p/EnEspeakG2P.hpp"
 #include "utils/g2p/ZhEspeakG2P.hpp"
+#include "utils/g2p/EspeakWorkerPool.hpp"
+
+#define NUM_THREADS     8
+#define REPEAT          10
 
 
 static void test_input_text(utils::EspeakG2P& g2p, const std::string& input_text, const std::string& language) {
@@ -63,15 +70,184 @@ static void test_zh(utils::ZhEspeakG2P& g2p) {
     printf("\n");
 }
 
+// 多个线程同时做 G2P: 本进程内(串行)和 worker 进程的结果应该一致
+// 每条文本都不同, 不会命中音素缓存
+static void test_worker_pool(utils::EspeakWorkerPool& pool, utils::EnEspeakG2P& g2p) {
+    const char* sentences[] = {
+        "Hello World",
+        "The quick brown fox jumps over the lazy dog",
+        "Text to speech on the edge needs a fast front end",
+        "How much wood would a woodchuck chuck if a woodchuck could chuck wood",
+    };
+    const int num_sentences = sizeof(sentences) / sizeof(sentences[0]);
+
+    g2p.get_cache().set_capacity(0);
+    std::vector<std::string> texts(NUM_THREADS * REPEAT);
+    std::vector<std::string> expected(texts.size());
+    for (size_t i = 0; i < texts.size(); i++) {
+        texts[i] = std::string(sentences[i % num_sentences]) + " " + std::to_string(i);
+        int err = 0;
+        expected[i] = g2p.run(texts[i], err);
+    }
+
+    auto run_threads = [&](bool use_pool, int& mismatches) {
+        std::atomic<int> num_mismatches{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (int n = 0; n < REPEAT; n++) {
+                    int i = t * REPEAT + n;
+                    int err = 0;
+                    std::string phonemes;
+                    if (!use_pool || !pool.run(texts[i], phonemes, err)) {
+                        phonemes = g2p.run(texts[i], err);
+                    }
+                    if (err != 0 || phonemes != expected[i]) {
+                        num_mismatches++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        mismatches = num_mismatches;
+    };
+
+    int mismatches = 0;
+    Timer timer;
+    run_threads(false, mismatches);
+    float in_process_ms = timer.elapsed();
+
+    int pool_mismatches = 0;
+    timer.start();
+    run_threads(true, pool_mismatches);
+    float pool_ms = timer.elapsed();
+
+    printf("================================\n");
+    printf("test_worker_pool: %d threads x %d sentences\n", NUM_THREADS, REPEAT);
+    printf("in process: %.2f ms, %d mismatches\n", in_process_ms, mismatches);
+    printf("%d workers: %.2f ms (%.2fx), %d mismatches\n", pool.size(), pool_ms, in_process_ms / pool_ms, pool_mismatches);
+    uint64_t hits = 0, misses = 0;
+    pool.cache_stats(hits, misses);
+    printf("worker caches: hits %llu, misses %llu\n", (unsigned long long)hits, (unsigned long long)misses);
+    printf("\n");
+    g2p.get_cache().set_capacity(ESPEAK_CACHE_CAPACITY);
+}
+
+// 缓存的结果应该与每次都调用 espeak 的一致, 重复的句子和短句命中缓存
+static void test_cache(utils::EnEspeakG2P& g2p, utils::EnEspeakG2P& nocache_g2p) {
+    const char* sentences[] = {
+        "Hello, World!",
+        "Yes. No. Yes, please.",
+        "The quick brown fox jumps over the lazy dog.",
+        "Hello, how are you? Fine, thank you.",
+        "The quick brown fox jumps over the lazy dog, again.",
+    };
+    const int num_sentences = sizeof(sentences) / sizeof(sentences[0]);
+
+    utils::PhonemeCache& cache = g2p.get_cache();
+    cache.clear();
+
+    int mismatches = 0;
+    float times_ms[2];
+    for (int round = 0; round < 2; round++) {
+        Timer timer;
+        for (int i = 0; i < num_sentences; i++) {
+            int err = 0;
+            if (g2p.run(sentences[i], err) != nocache_g2p.run(sentences[i], err)) {
+                mismatches++;
+            }
+        }
+        times_ms[round] = timer.elapsed();
+    }
+
+    printf("================================\n");
+    printf("test_cache:\n");
+    printf("%d mismatches with the cache disabled\n", mismatches);
+    printf("hits %llu, misses %llu, hit rate %.2f, %d entries, %d bytes\n", 
+        (unsigned long long)cache.hits(), (unsigned long long)cache.misses(), cache.hit_rate(),
+        (int)cache.num_entries(), (int)cache.size_bytes());
+    printf("cold: %.3f ms, warm: %.3f ms (both include the uncached instance)\n", times_ms[0], times_ms[1]);
+
+    // 容量很小时淘汰最久未用的, 占用不超过容量
+    cache.set_capacity(256);
+    for (int i = 0; i < num_sentences; i++) {
+        int err = 0;
+        g2p.run(sentences[i], err);
+    }
+    printf("capacity 256: %d entries, %d bytes\n", (int)cache.num_entries(), (int)cache.size_bytes());
+    cache.set_capacity(ESPEAK_CACHE_CAPACITY);
+    printf("\n");
+}
+
+// 按段和按词缓存的命中率. 词汇重复但句子几乎不重复时, 按段缓存只有短句能命中
+static void test_cache_words(utils::EnEspeakG2P& segment_g2p, utils::EnEspeakG2P& word_g2p) {
+    const char* sentences[] = {
+        "Your order has shipped and will arrive on Monday.",
+        "Your order has been cancelled, and a refund is on the way.",
+        "Thank you for calling. How can I help you today?",
+        "Your package will arrive on Tuesday, between nine and five.",
+        "Please hold, your call is important to us.",
+        "Your refund has been processed and will arrive in five days.",
+        "Thank you for your patience. How else can I help you?",
+        "Your order will arrive on Friday, please keep your phone nearby.",
+        "Is there anything else I can help you with today?",
+        "Thank you for calling, and have a nice day.",
+    };
+    const int num_sentences = sizeof(sentences) / sizeof(sentences[0]);
+
+    segment_g2p.get_cache().clear();
+    word_g2p.get_cache().clear();
+    word_g2p.set_cache_words(true);
+
+    // 与按段的结果不同的句子数, 来自 espeak 的上下文相关发音
+    int differ = 0;
+    for (int i = 0; i < num_sentences; i++) {
+        int err = 0;
+        if (segment_g2p.run(sentences[i], err) != word_g2p.run(sentences[i], err)) {
+            differ++;
+        }
+    }
+
+    printf("================================\n");
+    printf("test_cache_words: %d sentences\n", num_sentences);
+    printf("segment keys: hits %llu, misses %llu, hit rate %.2f\n", 
+        (unsigned long long)segment_g2p.get_cache().hits(), (unsigned long long)segment_g2p.get_cache().misses(), 
+        segment_g2p.get_cache().hit_rate());
+    printf("word keys: hits %llu, misses %llu, hit rate %.2f, %d sentences differ from segment keys\n", 
+        (unsigned long long)word_g2p.get_cache().hits(), (unsigned long long)word_g2p.get_cache().misses(), 
+        word_g2p.get_cache().hit_rate(), differ);
+
+    // 大小写和首尾的标点不影响按词缓存的键, 应该只有 1 条记录, 命中 3 次
+    word_g2p.get_cache().clear();
+    const char* variants[] = {"Hello", "hello", "'HELLO'", "hello-"};
+    for (const char* variant : variants) {
+        int err = 0;
+        word_g2p.run(variant, err);
+    }
+    printf("normalized word keys: %d entries, hits %llu (expected 1 entry, 3 hits)\n", 
+        (int)word_g2p.get_cache().num_entries(), (unsigned long long)word_g2p.get_cache().hits());
+    printf("\n");
+}
+
 int main(int argc, char** argv) {
     cmdline::parser cmd;
     cmd.add<std::string>("language", 'l', "Language, in ISO-639 format", false, "en");
     cmd.add<std::string>("text", 't', "Input text", false, "");
+    cmd.add<int>("workers", 'w', "Number of g2p worker processes", false, 4);
     cmd.parse_check(argc, argv);
     
     // 0. get app args, can be removed from user's app
     auto input_text = cmd.get<std::string>("text");
     auto language = cmd.get<std::string>("language");
+    auto num_workers = cmd.get<int>("workers");
+
+    // worker 在本进程初始化 espeak 之前 fork
+    utils::EspeakWorkerPool pool;
+    if (!pool.start(num_workers, "./espeak-ng-data", utils::EnEspeakG2P::espeak_language(false))) {
+        ALOGE("Start g2p workers failed!");
+    }
 
     utils::EspeakG2P g2p;
     utils::EnEspeakG2P eng2p;
@@ -79,6 +255,14 @@ int main(int argc, char** argv) {
 
     test_en(eng2p);
     test_zh(zhg2p);
+    test_worker_pool(pool, eng2p);
+
+    utils::EnEspeakG2P nocache_eng2p;
+    nocache_eng2p.get_cache().set_capacity(0);
+    test_cache(eng2p, nocache_eng2p);
+
+    utils::EnEspeakG2P word_eng2p;
+    test_cache_words(eng2p, word_eng2p);
 
     if (!input_text.empty() && !language.empty()) {
         test_input_text(g2p, input_text, language);
@@ -0,0 +1,88 @@
+/**************************************************************************************************
+ *
+ * Copyright (c) 2019-2026 Axera Semiconductor (Ningbo) Co., Ltd. All Rights Reserved.
+ *
+ * This source file is the property of Axera Semiconductor (Ningbo) Co., Ltd. and
+ * may not be copied or distributed in any isomorphic form without the prior
+ * written consent of Axera Semiconductor (Ningbo) Co., Ltd.
+ *
+ **************************************************************************************************/
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "utils/cmdline.hpp"
+#include "utils/logger.h"
+#include "utils/timer.hpp"
+#include "tts/kokoro_har.hpp"
+#include "onnxruntime_cxx_api.h"
+
+#define SAMPLE_RATE     24000
+#define N_FFT           20
+#define HOP_LENGTH      5
+#define DEFAULT_F0_LEN  192
+
+int main(int argc, char** argv) {
+    cmdline::parser cmd;
+    cmd.add<std::string>("model_path", 'm', "Directory of model4_har_sim.onnx and har_weights.bin", false, "models-ax650/kokoro");
+    cmd.parse_check(argc, argv);
+    auto model_path = cmd.get<std::string>("model_path");
+
+    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "test_har");
+    Ort::SessionOptions session_options;
+    session_options.SetIntraOpNumThreads(1);
+    Ort::Session session(env, (model_path + "/model4_har_sim.onnx").c_str(), session_options);
+
+    KokoroHar har(SAMPLE_RATE, N_FFT, HOP_LENGTH);
+    if (!har.load(model_path + "/har_weights.bin")) {
+        ALOGE("Load har weights failed!");
+        return -1;
+    }
+
+    // 模型是静态形状时按模型的输入长度测试
+    auto input_shape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    for (auto& dim : input_shape) {
+        if (dim < 0)
+            dim = 1;
+    }
+    if (input_shape.back() == 1)
+        input_shape.back() = DEFAULT_F0_LEN;
+    int f0_len = input_shape.back();
+    auto f0 = KokoroHar::make_test_f0(f0_len);
+
+    const char* input_names[] = {"F0_pred"};
+    const char* output_names[] = {"har"};
+    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
+        memory_info, f0.data(), f0.size(), input_shape.data(), input_shape.size());
+
+    Timer timer;
+    auto outputs = session.Run(Ort::RunOptions{nullptr}, input_names, &input_tensor, 1, output_names, 1);
+    float onnx_ms = timer.elapsed();
+
+    auto output_shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+    int num_frames = output_shape.back();
+    int n_freq = N_FFT / 2 + 1;
+    const float* expected = outputs[0].GetTensorData<float>();
+
+    std::vector<float> actual(2 * n_freq * num_frames);
+    timer.start();
+    if (!har.run(f0.data(), f0_len, actual.data(), num_frames)) {
+        ALOGE("KokoroHar run failed!");
+        return -1;
+    }
+    float native_ms = timer.elapsed();
+
+    // 与 Kokoro 初始化时选择 HAR 实现用的是同一个对比
+    float mag_err = 0, phase_err = 0;
+    bool pass = har.compare(expected, actual.data(), num_frames, mag_err, phase_err);
+    printf("================================\n");
+    printf("test_har:\n");
+    printf("F0 length: %d, har frames: %d\n", f0_len, num_frames);
+    printf("onnxruntime: %.3f ms, native: %.3f ms\n", onnx_ms, native_ms);
+    printf("max magnitude error: %g (relative), max phase error: %g rad\n", mag_err, phase_err);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    return pass ? 0 : -1;
+}
@@ -8,6 +8,9 @@
  *
  **************************************************************************************************/
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
 
 #include "utils/cmdline.hpp"
 #include "utils/logger.h"
@@ -33,6 +36,7 @@ static void test_en(AX_TTS_HANDLE handle) {
     std::string input_text("Hello, World!");
     
     AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
     run_config.fade_out = 0.3f;
     run_config.speed = 1.0f;
     run_config.sample_rate = 24000;
@@ -70,18 +74,473 @@ static void test_en(AX_TTS_HANDLE handle) {
     printf("\n");
 }
 
+static void test_en_phonemes(AX_TTS_HANDLE handle) {
+    // "Hello, World!" 经过 espeak 后的音素, 调用者已经有音素时不必再跑前端
+    std::string phonemes("həlˈoʊ, wˈɜːld!");
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_phonemes:\n");
+
+    AX_TTS_AUDIO* audio = nullptr;
+    int ret = AX_TTS_RunPhonemes(handle, phonemes.c_str(), &run_config, &audio);
+    if (ret != 0) {
+        ALOGE("AX_TTS_RunPhonemes failed!");
+        return;
+    }
+
+    std::string output_wav("test_en_phonemes.wav");
+    AudioFile<float> audio_file;
+    std::vector<std::vector<float> > audio_samples{std::vector<float>(audio->data, audio->data + audio->num_samples)};
+    audio_file.setAudioBuffer(audio_samples);
+    audio_file.setSampleRate(run_config.sample_rate);
+    if (!audio_file.save(output_wav)) {
+        ALOGE("Save audio file failed!\n");
+    }
+
+    printf("input phonemes: %s\n", phonemes.c_str());
+    printf("output duration: %.2f seconds\n", audio->num_samples * 1.0f / run_config.sample_rate);
+    printf("output file: %s\n", output_wav.c_str());
+    printf("\n");
+    free(audio);
+}
+
+static void test_en_s16(AX_TTS_HANDLE handle) {
+    std::string input_text("Hello, World! This one comes out as sixteen bit PCM.");
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    run_config.sample_format = AX_TTS_SAMPLE_INT16_DITHER;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    AX_TTS_AUDIO* audio = NULL;
+    int ret = AX_TTS_Run(handle, 
+                   input_text.c_str(), 
+                   &run_config,
+                   &audio); 
+    if (ret != 0) {
+        ALOGE("AX_TTS_Run failed!");
+        free(audio);
+        return;
+    }
+
+    // 直接写裸 PCM, 可以用 aplay -f S16_LE -r 24000 -c 1 播放
+    std::string output_pcm("test_en_s16.pcm");
+    FILE* fp = fopen(output_pcm.c_str(), "wb");
+    if (!fp) {
+        ALOGE("Open %s failed!", output_pcm.c_str());
+        free(audio);
+        return;
+    }
+    fwrite(AX_TTS_AUDIO_S16(audio), sizeof(int16_t), audio->num_samples, fp);
+    fclose(fp);
+
+    printf("================================\n");
+    printf("test_en_s16:\n");
+    printf("input text: %s\n", input_text.c_str());
+    printf("output duration: %.2f seconds\n", audio->num_samples * 1.0f / audio->sample_rate);
+    printf("output file: %s\n", output_pcm.c_str());
+    printf("\n");
+
+    free(audio);
+}
+
+static void test_en_into(AX_TTS_HANDLE handle) {
+    std::string input_text("Hello, World! The audio goes straight into a buffer owned by the caller.");
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_into:\n");
+
+    // 故意给一个放不下的缓冲, 按返回的大小重试
+    std::vector<float> buffer(run_config.sample_rate);
+    int num_samples = 0;
+    int ret = AX_TTS_RunInto(handle, input_text.c_str(), &run_config, 
+                   buffer.data(), buffer.size(), &num_samples);
+    if (ret == AX_TTS_ERR_BUFFER_TOO_SMALL) {
+        printf("buffer of %d samples too small, %d required\n", (int)buffer.size(), num_samples);
+        buffer.resize(num_samples);
+        ret = AX_TTS_RunInto(handle, input_text.c_str(), &run_config, 
+                   buffer.data(), buffer.size(), &num_samples);
+    }
+    if (ret != 0) {
+        ALOGE("AX_TTS_RunInto failed! ret=%d", ret);
+        return;
+    }
+
+    std::string output_wav("test_en_into.wav");
+    AudioFile<float> audio_file;
+    std::vector<std::vector<float> > audio_samples{std::vector<float>(buffer.begin(), buffer.begin() + num_samples)};
+    audio_file.setAudioBuffer(audio_samples);
+    audio_file.setSampleRate(run_config.sample_rate);
+    if (!audio_file.save(output_wav)) {
+        ALOGE("Save audio file failed!\n");
+        return;
+    }
+
+    printf("input text: %s\n", input_text.c_str());
+    printf("output duration: %.2f seconds\n", num_samples * 1.0f / run_config.sample_rate);
+    printf("output file: %s\n", output_wav.c_str());
+    printf("\n");
+}
+
+static void test_en_async(AX_TTS_HANDLE handle) {
+    // 排队的短文本会被拼进同一次推理
+    const char* input_texts[] = {
+        "Hello, World!",
+        "Press one for sales.",
+        "Press two for support.",
+        "Goodbye.",
+        "Requests are queued and synthesized by worker threads, the caller only polls for the result.",
+    };
+    const int num_texts = sizeof(input_texts) / sizeof(input_texts[0]);
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_async:\n");
+
+    AX_TTS_REQUEST_ID request_ids[num_texts];
+    for (int i = 0; i < num_texts; i++) {
+        request_ids[i] = AX_TTS_Submit(handle, input_texts[i], &run_config);
+        if (request_ids[i] < 0) {
+            ALOGE("AX_TTS_Submit failed!");
+            return;
+        }
+    }
+
+    // 第一个请求用轮询, 其余的直接等待
+    AX_TTS_AUDIO* audio = NULL;
+    int polls = 0;
+    int ret = AX_TTS_ERR_NOT_READY;
+    while (ret == AX_TTS_ERR_NOT_READY) {
+        ret = AX_TTS_Poll(handle, request_ids[0], &audio);
+        polls++;
+    }
+    printf("request %lld finished after %d polls\n", (long long)request_ids[0], polls);
+
+    for (int i = 0; i < num_texts; i++) {
+        if (i > 0) {
+            ret = AX_TTS_Wait(handle, request_ids[i], &audio, -1);
+        }
+        if (ret != 0) {
+            ALOGE("Request %lld failed! ret=%d", (long long)request_ids[i], ret);
+            continue;
+        }
+
+        std::string output_wav = "test_en_async_" + std::to_string(i) + ".wav";
+        AudioFile<float> audio_file;
+        std::vector<std::vector<float> > audio_samples{std::vector<float>(audio->data, audio->data + audio->num_samples)};
+        audio_file.setAudioBuffer(audio_samples);
+        audio_file.setSampleRate(run_config.sample_rate);
+        if (!audio_file.save(output_wav)) {
+            ALOGE("Save audio file failed!\n");
+        }
+
+        printf("input text: %s\n", input_texts[i]);
+        printf("output duration: %.2f seconds\n", audio->num_samples * 1.0f / run_config.sample_rate);
+        printf("output file: %s\n", output_wav.c_str());
+        free(audio);
+        audio = NULL;
+    }
+    printf("\n");
+}
+
+static void test_en_batch(AX_TTS_HANDLE handle) {
+    const char* input_texts[] = {
+        "Welcome.",
+        "Please hold, your call is important to us.",
+        "Press one for sales. Press two for support. Press zero to speak to an operator.",
+        "Thank you for calling.",
+    };
+    const int num_texts = sizeof(input_texts) / sizeof(input_texts[0]);
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_batch:\n");
+
+    AX_TTS_AUDIO* audios[num_texts];
+    int ret = AX_TTS_RunBatch(handle, input_texts, num_texts, &run_config, audios);
+    if (ret != 0) {
+        ALOGE("AX_TTS_RunBatch failed! ret=%d", ret);
+    }
+
+    for (int i = 0; i < num_texts; i++) {
+        if (!audios[i]) {
+            continue;
+        }
+
+        std::string output_wav = "test_en_batch_" + std::to_string(i) + ".wav";
+        AudioFile<float> audio_file;
+        std::vector<std::vector<float> > audio_samples{std::vector<float>(audios[i]->data, audios[i]->data + audios[i]->num_samples)};
+        audio_file.setAudioBuffer(audio_samples);
+        audio_file.setSampleRate(run_config.sample_rate);
+        if (!audio_file.save(output_wav)) {
+            ALOGE("Save audio file failed!\n");
+        }
+
+        printf("input text: %s\n", input_texts[i]);
+        printf("output duration: %.2f seconds\n", audios[i]->num_samples * 1.0f / run_config.sample_rate);
+        printf("output file: %s\n", output_wav.c_str());
+        free(audios[i]);
+    }
+    printf("\n");
+}
+
+// 出错时 audios 的每一项都应该是 NULL, 按文档 free 非 NULL 的项不会释放调用者原来的值
+static void test_en_batch_null(AX_TTS_HANDLE handle) {
+    const char* input_texts[] = {
+        "Welcome.",
+        NULL,
+        "Thank you for calling.",
+    };
+    const int num_texts = sizeof(input_texts) / sizeof(input_texts[0]);
+
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_batch_null:\n");
+
+    // 用非 NULL 的垃圾值填充, 检查每一项都被清空
+    AX_TTS_AUDIO* audios[num_texts];
+    int failed = 0;
+    AX_TTS_HANDLE handles[] = {handle, NULL};
+    for (AX_TTS_HANDLE h : handles) {
+        for (int i = 0; i < num_texts; i++) {
+            audios[i] = reinterpret_cast<AX_TTS_AUDIO*>(static_cast<uintptr_t>(0x1000 + i));
+        }
+
+        int ret = AX_TTS_RunBatch(h, input_texts, num_texts, &run_config, audios);
+        if (ret == 0) {
+            ALOGE("AX_TTS_RunBatch with a NULL text should fail!");
+            failed++;
+        }
+        for (int i = 0; i < num_texts; i++) {
+            if (audios[i]) {
+                ALOGE("audios[%d] is not NULL after AX_TTS_RunBatch failed! handle=%p", i, h);
+                failed++;
+            }
+        }
+    }
+    printf("%s\n", failed == 0 ? "every audio is NULL" : "FAILED");
+    printf("\n");
+}
+
+// 拼接合成与单独合成的差异上限: 时长的相对误差, 音量 (RMS) 的差值
+#define PACK_MAX_DURATION_DIFF  0.2f
+#define PACK_MAX_LEVEL_DIFF_DB  3.0f
+
+static float audio_rms(const AX_TTS_AUDIO* audio) {
+    double sum = 0;
+    for (int i = 0; i < audio->num_samples; i++) {
+        sum += (double)audio->data[i] * audio->data[i];
+    }
+    return audio->num_samples > 0 ? (float)sqrt(sum / audio->num_samples) : 0.0f;
+}
+
+// 不拼接时批量合成应与 AX_TTS_Run 逐个合成完全一致, 拼接时的差异不超过上面的上限
+static void test_en_batch_pack(AX_TTS_HANDLE handle) {
+    const char* input_texts[] = {
+        "Welcome.",
+        "Thank you for calling.",
+        "Goodbye.",
+        "Please hold, your call is important to us.",
+    };
+    const int num_texts = sizeof(input_texts) / sizeof(input_texts[0]);
+
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_batch_pack:\n");
+
+    AX_TTS_AUDIO* standalone[num_texts];
+    AX_TTS_AUDIO* unpacked[num_texts];
+    AX_TTS_AUDIO* packed[num_texts];
+    int failed = 0;
+    for (int i = 0; i < num_texts; i++) {
+        standalone[i] = NULL;
+        if (AX_TTS_Run(handle, input_texts[i], &run_config, &standalone[i]) != 0) {
+            ALOGE("AX_TTS_Run failed! text=%s", input_texts[i]);
+            failed++;
+        }
+    }
+
+    run_config.pack_texts = 0;
+    if (AX_TTS_RunBatch(handle, input_texts, num_texts, &run_config, unpacked) != 0) {
+        ALOGE("AX_TTS_RunBatch failed! pack_texts=0");
+        failed++;
+    }
+    run_config.pack_texts = 1;
+    if (AX_TTS_RunBatch(handle, input_texts, num_texts, &run_config, packed) != 0) {
+        ALOGE("AX_TTS_RunBatch failed! pack_texts=1");
+        failed++;
+    }
+
+    for (int i = 0; i < num_texts; i++) {
+        if (!standalone[i] || !unpacked[i] || !packed[i]) {
+            failed++;
+        } else {
+            if (unpacked[i]->num_samples != standalone[i]->num_samples || 
+                memcmp(unpacked[i]->data, standalone[i]->data, standalone[i]->num_samples * sizeof(float)) != 0) {
+                ALOGE("Unpacked audio of text %d differs from AX_TTS_Run!", i);
+                failed++;
+            }
+
+            float duration_diff = fabsf((float)packed[i]->num_samples / standalone[i]->num_samples - 1.0f);
+            float level_diff_db = 20.0f * log10f((audio_rms(packed[i]) + 1e-6f) / (audio_rms(standalone[i]) + 1e-6f));
+            printf("text %d: standalone %d samples, packed %d samples, duration diff %.1f%%, level diff %+.2f dB\n", 
+                   i, standalone[i]->num_samples, packed[i]->num_samples, duration_diff * 100, level_diff_db);
+            if (duration_diff > PACK_MAX_DURATION_DIFF || fabsf(level_diff_db) > PACK_MAX_LEVEL_DIFF_DB) {
+                ALOGE("Packed audio of text %d differs too much from AX_TTS_Run!", i);
+                failed++;
+            }
+        }
+        free(standalone[i]);
+        free(unpacked[i]);
+        free(packed[i]);
+    }
+    printf("%s\n", failed == 0 ? "packed audio within bounds" : "FAILED");
+    printf("\n");
+}
+
+static int on_stream_chunk(const AX_TTS_AUDIO* audio, int is_last, void* user_data) {
+    auto samples = static_cast<std::vector<float>*>(user_data);
+    samples->insert(samples->end(), audio->data, audio->data + audio->num_samples);
+    printf("chunk: %d samples, is_last: %d\n", audio->num_samples, is_last);
+    return 0;
+}
+
+static void test_en_stream(AX_TTS_HANDLE handle) {
+    std::string input_text("Hello, World! This is a streaming test. Audio arrives sentence by sentence.");
+    
+    AX_TTS_RUN_CONFIG run_config;
+    memset(&run_config, 0, sizeof(run_config));
+    run_config.fade_out = 0.3f;
+    run_config.speed = 1.0f;
+    run_config.sample_rate = 24000;
+    snprintf(run_config.language, AX_TTS_MAX_STR_LEN, "%s", "en");
+    snprintf(run_config.voice, AX_TTS_MAX_STR_LEN, "%s", "af_heart");
+
+    printf("================================\n");
+    printf("test_en_stream:\n");
+
+    std::vector<float> samples;
+    int ret = AX_TTS_RunStream(handle, 
+                   input_text.c_str(), 
+                   &run_config,
+                   on_stream_chunk,
+                   &samples); 
+    if (ret != 0) {
+        ALOGE("AX_TTS_RunStream failed!");
+        return;
+    }
+
+    std::string output_wav("test_en_stream.wav");
+    AudioFile<float> audio_file;
+    std::vector<std::vector<float> > audio_samples{samples};
+    audio_file.setAudioBuffer(audio_samples);
+    audio_file.setSampleRate(run_config.sample_rate);
+    if (!audio_file.save(output_wav)) {
+        ALOGE("Save audio file failed!\n");
+        return;
+    }
+
+    printf("input text: %s\n", input_text.c_str());
+    printf("output duration: %.2f seconds\n", samples.size() * 1.0f / run_config.sample_rate);
+    printf("output file: %s\n", output_wav.c_str());
+    printf("\n");
+}
+
+static void print_stats(AX_TTS_HANDLE handle) {
+    static const char* stage_names[AX_TTS_STAGE_NUM] = {
+        "clean", "normalize", "g2p", "tokenize", "model1", "alignment", 
+        "model2", "har", "model3", "istft", "request",
+    };
+
+    AX_TTS_STATS stats;
+    if (AX_TTS_GetStats(handle, &stats, 0) != 0) {
+        ALOGE("AX_TTS_GetStats failed!");
+        return;
+    }
+
+    printf("================================\n");
+    printf("stats:\n");
+    printf("%-10s %8s %10s %10s %10s %10s %10s\n", "stage", "count", "mean(ms)", "p50(ms)", "p95(ms)", "p99(ms)", "max(ms)");
+    for (int i = 0; i < AX_TTS_STAGE_NUM; i++) {
+        const AX_TTS_STAGE_STATS& s = stats.stages[i];
+        printf("%-10s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", stage_names[i], (unsigned long long)s.count, 
+            s.mean_ms, s.p50_ms, s.p95_ms, s.p99_ms, s.max_ms);
+    }
+    printf("requests: %llu, failed: %llu, audio: %.2f seconds, rtf: %.3f\n", 
+        (unsigned long long)stats.num_requests, (unsigned long long)stats.num_failed, stats.audio_seconds, stats.rtf);
+    printf("g2p workers running: %d\n", stats.num_g2p_workers);
+    uint64_t lookups = stats.g2p_cache_hits + stats.g2p_cache_misses;
+    printf("g2p cache: hits %llu, misses %llu, hit rate %.2f\n", (unsigned long long)stats.g2p_cache_hits, 
+        (unsigned long long)stats.g2p_cache_misses, lookups > 0 ? (float)stats.g2p_cache_hits / lookups : 0.0f);
+    printf("\n");
+}
+
 int main(int argc, char** argv) {
     cmdline::parser cmd;
     cmd.add<std::string>("language", 'l', "Language, in ISO-639 format", false, "en");
     cmd.add<std::string>("text", 't', "Input text", false, "");
+    cmd.add<std::string>("trace", 0, "Write a Chrome trace of the tests to this file", false, "");
+    cmd.add("cache_words", 0, "Cache espeak output per word instead of per punctuation segment");
     cmd.parse_check(argc, argv);
     
     // 0. get app args, can be removed from user's app
     auto input_text = cmd.get<std::string>("text");
     auto language = cmd.get<std::string>("language");
+    auto trace_path = cmd.get<std::string>("trace");
 
     AX_TTS_INIT_CONFIG init_config;
+    memset(&init_config, 0, sizeof(init_config));
     init_config.max_seq_len = 96;
+    init_config.num_contexts = 2;
+    init_config.num_g2p_workers = 2;
+    init_config.g2p_cache_words = cmd.exist("cache_words") ? 1 : 0;
     snprintf(init_config.model_path, AX_TTS_MAX_STR_LEN, "%s", "models-ax650/kokoro");
     snprintf(init_config.espeak_data_path, AX_TTS_MAX_STR_LEN, "%s", "espeak-ng-data");
 
@@ -93,12 +552,35 @@ int main(int argc, char** argv) {
 
     ALOGI("AX_TTS_Init success");
 
+    const char* voices[] = {"af_heart"};
+    if (AX_TTS_Warmup(handle, voices, 1) != 0) {
+        ALOGE("AX_TTS_Warmup failed!");
+    }
+
+    if (!trace_path.empty() && AX_TTS_StartTrace(handle, trace_path.c_str()) != 0) {
+        ALOGE("AX_TTS_StartTrace failed!");
+    }
+
     test_en(handle);
+    test_en_stream(handle);
+    test_en_into(handle);
+    test_en_s16(handle);
+    test_en_phonemes(handle);
+    test_en_async(handle);
+    test_en_batch(handle);
+    test_en_batch_null(handle);
+    test_en_batch_pack(handle);
 
     if (!input_text.empty() && !language.empty()) {
         test_input_text(handle, input_text, language);
     }
 
+    print_stats(handle);
+
+    if (!trace_path.empty()) {
+        AX_TTS_StopTrace(handle);
+    }
+
     AX_TTS_Uninit(handle);
     
     return 0;
@@ -8,24 +8,171 @@
  *
  **************************************************************************************************/
 #include <stdio.h>
+#include <regex>
+#include <random>
 
 #include "utils/g2p/Punctuator.hpp"
+#include "utils/timer.hpp"
+
+#define NUM_RANDOM  20000
+#define REPEAT      200
 
 static utils::Punctuator punc;
 
+// 原来的实现: 每次 run 按字节构造正则的字符类, 多字节标点会被拆成单个字节
+static std::vector<utils::LineMarkPair> legacy_split_by_marks(const std::string& str, const std::string& delimiterChars) {
+    std::vector<utils::LineMarkPair> result;
+    if (str.empty()) return result;
+    if (delimiterChars.empty()) {
+        result.emplace_back(str, "");
+        return result;
+    }
+
+    std::string escaped;
+    for (char c : delimiterChars) {
+        if (c == '\\' || c == '^' || c == '$' || c == '.' || c == '|' ||
+            c == '?' || c == '*' || c == '+' || c == '(' || c == ')' ||
+            c == '[' || c == ']' || c == '{' || c == '}') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    std::regex re("([^" + escaped + "]+)|([" + escaped + "])");
+    for (std::sregex_iterator it(str.begin(), str.end(), re), end; it != end; ++it) {
+        if ((*it)[1].matched) {
+            result.emplace_back((*it)[1].str(), "");
+        } else if ((*it)[2].matched) {
+            if (!result.empty() && result.back().second.empty()) {
+                result.back().second = (*it)[2].str();
+            } else {
+                result.emplace_back("", (*it)[2].str());
+            }
+        }
+    }
+    return result;
+}
+
+static void print_line_marks(const std::vector<utils::LineMarkPair>& line_marks) {
+    for (int i = 0; i < line_marks.size(); i++) {
+        printf("Line[%d]: text: %s \t mark: %s\n", i, line_marks[i].first.c_str(), line_marks[i].second.c_str());
+    }
+}
+
+// 比较结果, 不同时打印两者, 返回是否一致
+static bool expect_line_marks(const char* name, const std::vector<utils::LineMarkPair>& line_marks,
+                              const std::vector<utils::LineMarkPair>& expected) {
+    if (line_marks == expected) {
+        return true;
+    }
+    printf("%s failed, got:\n", name);
+    print_line_marks(line_marks);
+    printf("expected:\n");
+    print_line_marks(expected);
+    return false;
+}
+
 void test_en() {
     std::string text("Hello, World!");
     auto line_marks = punc.run(text);
 
     printf("test_en:\n");
     printf("Input text: %s\n", text.c_str());
-    for (int i = 0; i < line_marks.size(); i++) {
-        printf("Line[%d]: text: %s \t mark: %s\n", i, line_marks[i].first.c_str(), line_marks[i].second.c_str());
+    print_line_marks(line_marks);
+}
+
+int test_multibyte_marks() {
+    // 原来按字节匹配, — … “ ” « » 会被拆成单个字节, € 等含相同字节的字符也会被切开
+    std::string text("“Wait…” she said — «100 €» please!");
+    auto line_marks = punc.run(text);
+
+    printf("test_multibyte_marks:\n");
+    printf("Input text: %s\n", text.c_str());
+    print_line_marks(line_marks);
+
+    int failed = 0;
+    failed += !expect_line_marks("test_multibyte_marks", line_marks, {
+        {"", "“"}, {"Wait", "…"}, {"", "”"}, {" she said ", "—"}, {" ", "«"}, {"100 €", "»"}, {" please", "!"},
+    });
+    // 与标点共用前缀字节的字符不能被切开: … 是 E2 80 A6, € 是 E2 82 AC, ‚ 是 E2 80 9A
+    failed += !expect_line_marks("test_multibyte_prefix", punc.run("€‚…"), {{"€‚", "…"}});
+    // 末尾被截断的多字节标点不是标点
+    failed += !expect_line_marks("test_truncated_mark", punc.run("a\xe2\x80"), {{"a\xe2\x80", ""}});
+    return failed;
+}
+
+// 输入或标点表中的非法 UTF-8 字节不会被当成标点
+int test_invalid_utf8() {
+    int failed = 0;
+    failed += !expect_line_marks("test_invalid_input", punc.run("a\xff\xfe" "b, c\x80"), {{"a\xff\xfe" "b", ","}, {" c\x80", ""}});
+
+    // 标点表中的非法字节被忽略, 其余的标点照常生效
+    utils::Punctuator bad_punc(std::string(",\xff\xe2\x80", 4));
+    failed += !expect_line_marks("test_invalid_marks", bad_punc.run("a\xfe" "b,c\xff" "d\xe2\x80"),
+        {{"a\xfe" "b", ","}, {"c\xff" "d\xe2\x80", ""}});
+
+    printf("test_invalid_utf8: %d failed\n", failed);
+    return failed;
+}
+
+// 只含 ASCII 标点时结果应与原来的实现完全一致, 返回不一致的个数
+int test_conformance() {
+    const std::string ascii_marks(";:,.!?\"(){}[]");
+    const char* pieces[] = {
+        "a", "b", "Hello", " ", "  ", "world", "123", "中文", "é",
+        ";", ":", ",", ".", "!", "?", "\"", "(", ")", "{", "}", "[", "]", "...", "?!",
+    };
+    const int num_pieces = sizeof(pieces) / sizeof(pieces[0]);
+
+    utils::Punctuator ascii_punc(ascii_marks);
+    std::mt19937 rng(0);
+    int mismatches = 0;
+    for (int n = 0; n < NUM_RANDOM; n++) {
+        std::string text;
+        int len = rng() % 16;
+        for (int k = 0; k < len; k++) {
+            text += pieces[rng() % num_pieces];
+        }
+
+        if (ascii_punc.run(text) != legacy_split_by_marks(text, ascii_marks)) {
+            if (mismatches < 5) {
+                printf("mismatch: %s\n", text.c_str());
+            }
+            mismatches++;
+        }
+    }
+
+    printf("test_conformance: %d / %d random inputs differ from the regex splitter\n", mismatches, NUM_RANDOM);
+    return mismatches;
+}
+
+void bench() {
+    std::string text("Hello, my world! This is a longer sentence; it has: several marks (and brackets). "
+                     "Does it work? Yes... \"Quoted\" text, [more] and {more}.");
+
+    Timer timer;
+    for (int i = 0; i < REPEAT; i++) {
+        legacy_split_by_marks(text, punc.get_marks());
+    }
+    float legacy_ms = timer.elapsed() / REPEAT;
+
+    timer.start();
+    for (int i = 0; i < REPEAT; i++) {
+        punc.run(text);
     }
+    float scanner_ms = timer.elapsed() / REPEAT;
+
+    printf("bench: %d bytes, %d runs\n", (int)text.size(), REPEAT);
+    printf("regex splitter: %.4f ms\n", legacy_ms);
+    printf("codepoint scanner: %.4f ms (%.2fx)\n", scanner_ms, legacy_ms / scanner_ms);
 }
 
 int main(int argc, char** argv) {
     test_en();
+    int failed = test_multibyte_marks();
+    failed += test_invalid_utf8();
+    failed += test_conformance();
+    bench();
     
-    return 0;
-}
\ No newline at end of file
+    return failed > 0 ? 1 : 0;
+}